@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Heap storage that honours alignas(64) on cache-line padded types. Before C++17, plain
+// new only guarantees alignof(std::max_align_t), so padded per-worker slots would still
+// straddle cache lines and share them with their neighbours.
+inline void *alignedAllocate(size_t bytes, size_t alignment) {
+    void *raw = ::operator new(bytes + alignment + sizeof(void *));
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void *);
+    uintptr_t aligned = (start + alignment - 1) & ~uintptr_t(alignment - 1);
+    reinterpret_cast<void **>(aligned)[-1] = raw;
+    return reinterpret_cast<void *>(aligned);
+}
+
+inline void alignedFree(void *pointer) {
+    if (pointer) {
+        ::operator delete(reinterpret_cast<void **>(pointer)[-1]);
+    }
+}
+
+template<typename T>
+struct AlignedDelete {
+    size_t count = 1;
+
+    void operator()(T *pointer) const {
+        if (!pointer) {
+            return;
+        }
+        for (size_t i = count; i > 0; i--) {
+            pointer[i - 1].~T();
+        }
+        alignedFree(pointer);
+    }
+};
+
+template<typename T>
+using AlignedPtr = std::unique_ptr<T, AlignedDelete<T>>;
+
+template<typename T>
+using AlignedArray = std::unique_ptr<T[], AlignedDelete<T>>;
+
+template<typename T, typename ...Args>
+AlignedPtr<T> makeAligned(Args &&...args) {
+    void *memory = alignedAllocate(sizeof(T), alignof(T));
+    try {
+        return AlignedPtr<T>(new(memory) T(std::forward<Args>(args)...), AlignedDelete<T>());
+    } catch (...) {
+        alignedFree(memory);
+        throw;
+    }
+}
+
+// Value-initialized elements.
+template<typename T>
+AlignedArray<T> makeAlignedArray(size_t count) {
+    T *elements = static_cast<T *>(alignedAllocate(sizeof(T) * count, alignof(T)));
+    size_t constructed = 0;
+    try {
+        for (; constructed < count; constructed++) {
+            new(elements + constructed) T();
+        }
+    } catch (...) {
+        AlignedDelete<T>{constructed}(elements);
+        throw;
+    }
+    return AlignedArray<T>(elements, AlignedDelete<T>{count});
+}
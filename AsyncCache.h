@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "Aligned.h"
+#include "ThreadPool.h"
+#include "SharedFuture.h"
+
+struct AsyncCacheOptions {
+    // Entries over all shards; each shard holds capacity / shards, at least 1.
+    size_t capacity = 1024;
+    size_t shards = 16;
+    // Counted from when the value is ready; zero keeps values until they are evicted.
+    std::chrono::steady_clock::duration ttl = std::chrono::steady_clock::duration::zero();
+};
+
+// Single-flight cache of computations on a ThreadPool. The first caller for a key schedules
+// the computation and every caller until it expires gets a SharedFuture of the same
+// result, including callers that arrive while it is still running. Keys are striped over
+// shards with a mutex each; a full shard evicts with CLOCK, passing over recently used
+// entries once. In-flight entries are never evicted; a shard holding nothing else grows
+// past its capacity until they finish. Failed computations are dropped from the cache as
+// they fail, so only the callers that joined them see the exception.
+template<typename K, typename V, typename Hash = std::hash<K>>
+class AsyncCache {
+public:
+    explicit AsyncCache(ThreadPool &pool, AsyncCacheOptions const &options = AsyncCacheOptions())
+            : pool(pool), shardCount(std::max<size_t>(1, options.shards)),
+              shardCapacity(std::max<size_t>(1, (options.capacity + shardCount - 1) / shardCount)),
+              ttl(options.ttl), shards(makeAlignedArray<Shard>(shardCount)), hits(0), joins(0), misses(0), evictions(0),
+              expirations(0), failures(0) {
+        alive = std::make_shared<Tracker>();
+        alive->cache = this;
+    }
+
+    AsyncCache(const AsyncCache &) = delete;
+
+    AsyncCache &operator=(const AsyncCache &) = delete;
+
+    // Runs compute() on the pool unless the key has a live entry. Computations still
+    // running when the cache is destroyed complete their futures but are not cached.
+    template<typename F>
+    SharedFuture<V> get(const K &key, F &&compute) {
+        Shard &shard = shardOf(key);
+        std::shared_ptr<Promise<V>> promise;
+        SharedFuture<V> future;
+        uint64_t id;
+        {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            auto found = shard.index.find(key);
+            if (found != shard.index.end()) {
+                Slot &slot = shard.slots[found->second];
+                if (!isExpired(slot, std::chrono::steady_clock::now())) {
+                    slot.referenced = true;
+                    (slot.value.isReady() ? hits : joins).fetch_add(1, std::memory_order_relaxed);
+                    return slot.value;
+                }
+                expirations.fetch_add(1, std::memory_order_relaxed);
+                removeLocked(shard, found->second);
+            }
+            misses.fetch_add(1, std::memory_order_relaxed);
+            promise = std::make_shared<Promise<V>>();
+            promise->setExecutor(&pool);
+            future = SharedFuture<V>(promise->getFuture());
+            id = ++shard.nextId;
+            insertLocked(shard, key, future, id);
+        }
+        std::shared_ptr<Tracker> tracker = alive;
+        std::function<V()> function(std::forward<F>(compute));
+        try {
+            pool.execute([tracker, key, id, ttl = this->ttl, promise, function]() {
+                V value;
+                try {
+                    value = function();
+                } catch (...) {
+                    fail(tracker, key, id, *promise, std::current_exception());
+                    return;
+                }
+                if (ttl != Clock::duration::zero()) {
+                    complete(tracker, key, id, ttl);
+                }
+                promise->set(std::move(value));
+            });
+        } catch (RejectedExecutionError &) {
+            fail(tracker, key, id, *promise, std::current_exception());
+        }
+        return future;
+    }
+
+    // Drops the key's entry; callers already holding its future keep it.
+    void invalidate(const K &key) {
+        Shard &shard = shardOf(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            removeLocked(shard, found->second);
+        }
+    }
+
+    void clear() {
+        for (size_t i = 0; i < shardCount; i++) {
+            std::unique_lock<std::mutex> lock(shards[i].mutex);
+            shards[i].index.clear();
+            shards[i].slots.clear();
+            shards[i].hand = 0;
+        }
+    }
+
+    AsyncCacheStats stats() const {
+        AsyncCacheStats stats;
+        for (size_t i = 0; i < shardCount; i++) {
+            std::unique_lock<std::mutex> lock(shards[i].mutex);
+            stats.size += shards[i].slots.size();
+        }
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.joins = joins.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        stats.evictions = evictions.load(std::memory_order_relaxed);
+        stats.expirations = expirations.load(std::memory_order_relaxed);
+        stats.failures = failures.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    ~AsyncCache() {
+        std::unique_lock<std::shared_timed_mutex> lock(alive->mutex);
+        alive->cache = nullptr;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Slot {
+        K key;
+        SharedFuture<V> value;
+        uint64_t id;
+        // time_point::max() until the value is ready.
+        Clock::time_point expiresAt;
+        bool referenced;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<K, size_t, Hash> index;
+        std::vector<Slot> slots;
+        size_t hand = 0;
+        uint64_t nextId = 0;
+    };
+
+    // Lets computations that outlive the cache find out. They hold the mutex shared while
+    // touching the cache, so they only contend with its destructor, not with each other.
+    struct Tracker {
+        std::shared_timed_mutex mutex;
+        AsyncCache *cache;
+    };
+
+    Shard &shardOf(const K &key) {
+        return shards[hasher(key) % shardCount];
+    }
+
+    bool isExpired(const Slot &slot, Clock::time_point now) const {
+        return slot.expiresAt != Clock::time_point::max() && now >= slot.expiresAt;
+    }
+
+    // A shard whose entries are all in flight grows past its capacity, and shrinks back as
+    // later inserts find finished entries to evict.
+    void insertLocked(Shard &shard, const K &key, const SharedFuture<V> &future, uint64_t id) {
+        while (shard.slots.size() >= shardCapacity) {
+            size_t victim = victimLocked(shard);
+            if (victim == shard.slots.size()) {
+                break;
+            }
+            removeLocked(shard, victim);
+        }
+        shard.index[key] = shard.slots.size();
+        shard.slots.push_back(Slot{key, future, id, Clock::time_point::max(), false});
+    }
+
+    // Expired entries go first; referenced ones get one more sweep. In-flight entries are
+    // never evicted, as the next caller for their key would start a second computation;
+    // returns slots.size() if every entry is in flight.
+    size_t victimLocked(Shard &shard) {
+        Clock::time_point now = Clock::now();
+        size_t size = shard.slots.size();
+        for (size_t steps = 0; steps < 2 * size; steps++) {
+            Slot &slot = shard.slots[shard.hand];
+            if (isExpired(slot, now)) {
+                expirations.fetch_add(1, std::memory_order_relaxed);
+                return shard.hand;
+            }
+            if (slot.value.isReady()) {
+                if (!slot.referenced) {
+                    evictions.fetch_add(1, std::memory_order_relaxed);
+                    return shard.hand;
+                }
+                slot.referenced = false;
+            }
+            shard.hand = (shard.hand + 1) % size;
+        }
+        return size;
+    }
+
+    void removeLocked(Shard &shard, size_t position) {
+        shard.index.erase(shard.slots[position].key);
+        if (position + 1 != shard.slots.size()) {
+            shard.slots[position] = std::move(shard.slots.back());
+            shard.index[shard.slots[position].key] = position;
+        }
+        shard.slots.pop_back();
+        if (shard.hand >= shard.slots.size()) {
+            shard.hand = 0;
+        }
+    }
+
+    // Starts the TTL of the entry, if it is still the one the computation was started for.
+    static void complete(const std::shared_ptr<Tracker> &tracker, const K &key, uint64_t id, Clock::duration ttl) {
+        std::shared_lock<std::shared_timed_mutex> trackerLock(tracker->mutex);
+        AsyncCache *cache = tracker->cache;
+        if (!cache) {
+            return;
+        }
+        Shard &shard = cache->shardOf(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end() && shard.slots[found->second].id == id) {
+            shard.slots[found->second].expiresAt = Clock::now() + ttl;
+        }
+    }
+
+    // Removes the entry before failing the future, so later callers compute again.
+    static void fail(const std::shared_ptr<Tracker> &tracker, const K &key, uint64_t id, Promise<V> &promise,
+                     std::exception_ptr error) {
+        {
+            std::shared_lock<std::shared_timed_mutex> trackerLock(tracker->mutex);
+            if (AsyncCache *cache = tracker->cache) {
+                cache->failures.fetch_add(1, std::memory_order_relaxed);
+                Shard &shard = cache->shardOf(key);
+                std::unique_lock<std::mutex> lock(shard.mutex);
+                auto found = shard.index.find(key);
+                if (found != shard.index.end() && shard.slots[found->second].id == id) {
+                    cache->removeLocked(shard, found->second);
+                }
+            }
+        }
+        promise.setException(error);
+    }
+
+    ThreadPool &pool;
+    const size_t shardCount;
+    const size_t shardCapacity;
+    const Clock::duration ttl;
+    AlignedArray<Shard> shards;
+    Hash hasher;
+    std::shared_ptr<Tracker> alive;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> joins;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+    std::atomic<uint64_t> expirations;
+    std::atomic<uint64_t> failures;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded multi-producer multi-consumer ring (Vyukov): each cell carries a sequence
+// number telling producers and consumers whose turn it is, so tryPush() and tryPop()
+// are a CAS on the shared position plus a store on the cell, without locks.
+// The ring is rounded up to a power of two, and to at least 2, which the sequence scheme
+// needs to tell a full cell from an empty one; tryPush() still refuses past the requested
+// capacity, so a queue of 1000 holds 1000 values, not 1024.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t requestedCapacity) : limit(std::max<size_t>(1, requestedCapacity)),
+                                                      mask(roundUp(limit) - 1), cells(new Cell[mask + 1]),
+                                                      enqueuePosition(0), dequeuePosition(0) {
+        for (size_t i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Moves from value only on success; returns false if the queue is full.
+    bool tryPush(T &&value) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            ptrdiff_t difference = ptrdiff_t(sequence) - ptrdiff_t(position);
+            if (difference == 0) {
+                if (mask + 1 != limit && position - dequeuePosition.load(std::memory_order_acquire) >= limit) {
+                    return false;
+                }
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &value) {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            ptrdiff_t difference = ptrdiff_t(sequence) - ptrdiff_t(position + 1);
+            if (difference == 0) {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate while producers or consumers are running.
+    size_t size() const {
+        size_t dequeued = dequeuePosition.load(std::memory_order_acquire);
+        size_t enqueued = enqueuePosition.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t capacity() const {
+        return limit;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUp(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    const size_t limit;
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueuePosition;
+    alignas(64) std::atomic<size_t> dequeuePosition;
+};
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+#include "Promise.h"
+#include "Future.h"
+
+class ChannelClosedError : public std::runtime_error {
+public:
+    ChannelClosedError() : std::runtime_error("Channel is closed") {
+    }
+};
+
+// Multi-producer multi-consumer channel. Values go through a lock-free BoundedQueue; an
+// unbounded channel spills into a locked overflow list once its ring is full. The mutex
+// is only taken to park or wake async senders and receivers: send() and recv() return
+// futures that the other side completes when it makes room or delivers a value, so a
+// waiting task does not occupy a worker unless it calls get() on the future.
+//
+// close() stops sends; values already in the channel can still be received, after which
+// receives fail with ChannelClosedError, as do the futures of parked senders.
+template<typename T>
+class Channel {
+public:
+    enum : size_t {
+        unboundedRingCapacity = 1024
+    };
+
+    // Unbounded.
+    Channel() : Channel(unboundedRingCapacity, false) {
+    }
+
+    // There is no unbuffered rendezvous mode: a capacity of 0 throws std::invalid_argument.
+    explicit Channel(size_t capacity) : Channel(checkedCapacity(capacity), true) {
+    }
+
+    Channel(const Channel &) = delete;
+
+    Channel &operator=(const Channel &) = delete;
+
+    ~Channel() {
+        close();
+    }
+
+    // Never blocks; false if the channel is full or closed, in which case value is untouched.
+    bool trySend(T &&value) {
+        if (closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (!pushValue(std::move(value))) {
+            return false;
+        }
+        wakeReceivers();
+        return true;
+    }
+
+    bool trySend(const T &value) {
+        T copy(value);
+        return trySend(std::move(copy));
+    }
+
+    // Never blocks; false if the channel is empty.
+    bool tryRecv(T &value) {
+        if (!popValue(value)) {
+            return false;
+        }
+        wakeSenders();
+        return true;
+    }
+
+    // Appends up to max values to out and returns how many; never blocks.
+    size_t tryRecvMany(std::vector<T> &out, size_t max) {
+        size_t received = 0;
+        T value;
+        while (received < max && popValue(value)) {
+            out.push_back(std::move(value));
+            received++;
+        }
+        if (received > 0) {
+            wakeSenders();
+        }
+        return received;
+    }
+
+    // Ready at once if there is room, else completed by the receiver that makes room.
+    // Fails with ChannelClosedError if the channel is, or gets, closed first.
+    Future<void> send(T value) {
+        std::shared_ptr<Promise<void>> promise = makePromise<void>();
+        Future<void> future = promise->getFuture();
+        if (trySend(std::move(value))) {
+            promise->set();
+            return future;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        waitingSenders.fetch_add(1, std::memory_order_seq_cst);
+        if (closed.load(std::memory_order_acquire)) {
+            waitingSenders.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+            promise->setException(std::make_exception_ptr(ChannelClosedError()));
+            return future;
+        }
+        if (pushValue(std::move(value))) {
+            waitingSenders.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+            promise->set();
+            wakeReceivers();
+            return future;
+        }
+        senders.push_back({std::move(value), promise});
+        return future;
+    }
+
+    // Ready at once if a value is available, else completed by the next sender. Fails with
+    // ChannelClosedError once the channel is closed and empty.
+    Future<T> recv() {
+        std::shared_ptr<Promise<T>> promise = makePromise<T>();
+        Future<T> future = promise->getFuture();
+        T value;
+        if (tryRecv(value)) {
+            promise->set(std::move(value));
+            return future;
+        }
+        addReceiver({promise, nullptr, 1});
+        return future;
+    }
+
+    // Completes with between 1 and max values, as soon as at least one is available.
+    Future<std::vector<T>> recvMany(size_t max) {
+        std::shared_ptr<Promise<std::vector<T>>> promise = makePromise<std::vector<T>>();
+        Future<std::vector<T>> future = promise->getFuture();
+        std::vector<T> values;
+        if (max > 0 && tryRecvMany(values, max) > 0) {
+            promise->set(std::move(values));
+            return future;
+        }
+        addReceiver({nullptr, promise, std::max<size_t>(1, max)});
+        return future;
+    }
+
+    void close() {
+        std::deque<Receiver> closedReceivers;
+        std::deque<Sender> closedSenders;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closed.exchange(true)) {
+                return;
+            }
+            closedReceivers.swap(receivers);
+            closedSenders.swap(senders);
+            waitingReceivers.store(0, std::memory_order_relaxed);
+            waitingSenders.store(0, std::memory_order_relaxed);
+        }
+        for (auto &receiver: closedReceivers) {
+            // A value sent just before close() may not have been handed out yet.
+            if (!serve(receiver)) {
+                fail(receiver);
+            }
+        }
+        for (auto &sender: closedSenders) {
+            sender.promise->setException(std::make_exception_ptr(ChannelClosedError()));
+        }
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    // Approximate while senders or receivers are running.
+    size_t size() const {
+        return queue.size() + overflowSize.load(std::memory_order_acquire);
+    }
+
+    // 0 for an unbounded channel.
+    size_t capacity() const {
+        return bounded ? queue.capacity() : 0;
+    }
+
+private:
+    struct Receiver {
+        std::shared_ptr<Promise<T>> one;
+        std::shared_ptr<Promise<std::vector<T>>> many;
+        size_t max;
+    };
+
+    struct Sender {
+        T value;
+        std::shared_ptr<Promise<void>> promise;
+    };
+
+    static size_t checkedCapacity(size_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Channel capacity must be at least 1");
+        }
+        return capacity;
+    }
+
+    Channel(size_t capacity, bool bounded) : queue(capacity), bounded(bounded), overflowSize(0), closed(false),
+                                             waitingReceivers(0), waitingSenders(0) {
+    }
+
+    // Futures carry the pool of the calling worker, so Map continuations stay on it.
+    template<typename V>
+    static std::shared_ptr<Promise<V>> makePromise() {
+        std::shared_ptr<Promise<V>> promise = std::make_shared<Promise<V>>();
+        if (ThreadPool::localThreadPoolPtr) {
+            promise->setExecutor(ThreadPool::localThreadPoolPtr);
+        }
+        return promise;
+    }
+
+    // Once values have spilled into the overflow list, new ones follow them there until
+    // receivers drain it, so that each sender's values stay in order.
+    bool pushValue(T &&value) {
+        if (bounded) {
+            return queue.tryPush(std::move(value));
+        }
+        if (overflowSize.load(std::memory_order_acquire) == 0 && queue.tryPush(std::move(value))) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(overflowMutex);
+        overflow.push_back(std::move(value));
+        overflowSize.store(overflow.size(), std::memory_order_release);
+        return true;
+    }
+
+    bool popValue(T &value) {
+        if (queue.tryPop(value)) {
+            return true;
+        }
+        if (overflowSize.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(overflowMutex);
+        if (overflow.empty()) {
+            return false;
+        }
+        value = std::move(overflow.front());
+        overflow.pop_front();
+        overflowSize.store(overflow.size(), std::memory_order_release);
+        return true;
+    }
+
+    // The waiting counters are raised under the mutex before the parked side re-checks the
+    // queue, and read after a seq_cst fence following every push or pop, so either the
+    // parked side sees the value or room, or the other side sees it parked.
+    void addReceiver(Receiver receiver) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitingReceivers.fetch_add(1, std::memory_order_seq_cst);
+        if (!serve(receiver)) {
+            if (closed.load(std::memory_order_acquire)) {
+                waitingReceivers.fetch_sub(1, std::memory_order_relaxed);
+                lock.unlock();
+                fail(receiver);
+                return;
+            }
+            receivers.push_back(std::move(receiver));
+            return;
+        }
+        waitingReceivers.fetch_sub(1, std::memory_order_relaxed);
+        lock.unlock();
+        wakeSenders();
+    }
+
+    void wakeReceivers() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waitingReceivers.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        bool served = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!receivers.empty() && serve(receivers.front())) {
+                receivers.pop_front();
+                waitingReceivers.fetch_sub(1, std::memory_order_relaxed);
+                served = true;
+            }
+        }
+        if (served) {
+            wakeSenders();
+        }
+    }
+
+    void wakeSenders() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waitingSenders.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        bool sent = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!senders.empty() && pushValue(std::move(senders.front().value))) {
+                senders.front().promise->set();
+                senders.pop_front();
+                waitingSenders.fetch_sub(1, std::memory_order_relaxed);
+                sent = true;
+            }
+        }
+        if (sent) {
+            wakeReceivers();
+        }
+    }
+
+    // Hands the receiver what is available; false if there was nothing.
+    bool serve(Receiver &receiver) {
+        T value;
+        if (!popValue(value)) {
+            return false;
+        }
+        if (receiver.one) {
+            receiver.one->set(std::move(value));
+            return true;
+        }
+        std::vector<T> values;
+        values.push_back(std::move(value));
+        while (values.size() < receiver.max && popValue(value)) {
+            values.push_back(std::move(value));
+        }
+        receiver.many->set(std::move(values));
+        return true;
+    }
+
+    static void fail(Receiver &receiver) {
+        std::exception_ptr error = std::make_exception_ptr(ChannelClosedError());
+        if (receiver.one) {
+            receiver.one->setException(error);
+        } else {
+            receiver.many->setException(error);
+        }
+    }
+
+    BoundedQueue<T> queue;
+    const bool bounded;
+    std::mutex overflowMutex;
+    std::deque<T> overflow;
+    std::atomic<size_t> overflowSize;
+    std::atomic<bool> closed;
+    std::mutex mutex;
+    std::deque<Receiver> receivers;
+    std::deque<Sender> senders;
+    std::atomic<size_t> waitingReceivers;
+    std::atomic<size_t> waitingSenders;
+};
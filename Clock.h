@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Raw timestamp for instrumentation hot paths: a single TSC read on x86, steady_clock
+// nanoseconds elsewhere. Convert differences with ticksToNanoseconds().
+inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline double nanosecondsPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ratio = []() {
+        auto startTime = std::chrono::steady_clock::now();
+        uint64_t startTicks = readTicks();
+        while (std::chrono::steady_clock::now() - startTime < std::chrono::milliseconds(10)) {
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - startTime);
+        uint64_t ticks = readTicks() - startTicks;
+        return ticks ? double(elapsed.count()) / ticks : 1.0;
+    }();
+    return ratio;
+#else
+    return 1.0;
+#endif
+}
+
+inline double ticksToNanoseconds(uint64_t ticks) {
+    return ticks * nanosecondsPerTick();
+}
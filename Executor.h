@@ -0,0 +1,12 @@
+#pragma once
+
+#include <functional>
+
+// Something tasks can be submitted to: a ThreadPool, or an executor layered on top of
+// one such as LimitedExecutor. Futures carry the executor their continuations run on.
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    virtual void execute(std::function<void()> const &function) = 0;
+};
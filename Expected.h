@@ -0,0 +1,175 @@
+#pragma once
+
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+template<typename E>
+struct Unexpected {
+    E error;
+};
+
+template<typename E>
+Unexpected<typename std::decay<E>::type> unexpected(E &&error) {
+    return {std::forward<E>(error)};
+}
+
+class BadExpectedAccess : public std::logic_error {
+public:
+    BadExpectedAccess() : std::logic_error("Expected holds an error") {
+    }
+};
+
+// A value or an error, stored in place: passing an error along costs a move instead of
+// an allocated exception_ptr and an unwind. A default-constructed Expected holds T().
+template<typename T, typename E>
+class Expected {
+public:
+    Expected() : ok(true) {
+        new(&val) T();
+    }
+
+    Expected(const T &value) : ok(true) {
+        new(&val) T(value);
+    }
+
+    Expected(T &&value) : ok(true) {
+        new(&val) T(std::move(value));
+    }
+
+    // Any error convertible to E, so setError("text") works for a std::string error.
+    template<typename G>
+    Expected(Unexpected<G> unexpected) : ok(false) {
+        new(&err) E(std::move(unexpected.error));
+    }
+
+    Expected(const Expected &other) : ok(other.ok) {
+        if (ok) {
+            new(&val) T(other.val);
+        } else {
+            new(&err) E(other.err);
+        }
+    }
+
+    Expected(Expected &&other) noexcept(std::is_nothrow_move_constructible<T>::value &&
+                                        std::is_nothrow_move_constructible<E>::value) : ok(other.ok) {
+        if (ok) {
+            new(&val) T(std::move(other.val));
+        } else {
+            new(&err) E(std::move(other.err));
+        }
+    }
+
+    // If the copy or move throws, this keeps what it held before.
+    Expected &operator=(const Expected &other) {
+        if (this != &other) {
+            assign(other);
+        }
+        return *this;
+    }
+
+    Expected &operator=(Expected &&other) noexcept(std::is_nothrow_move_constructible<T>::value &&
+                                                   std::is_nothrow_move_assignable<T>::value &&
+                                                   std::is_nothrow_move_constructible<E>::value &&
+                                                   std::is_nothrow_move_assignable<E>::value) {
+        if (this != &other) {
+            assign(std::move(other));
+        }
+        return *this;
+    }
+
+    ~Expected() {
+        destroy();
+    }
+
+    bool hasValue() const {
+        return ok;
+    }
+
+    explicit operator bool() const {
+        return ok;
+    }
+
+    // Throws BadExpectedAccess if there is an error.
+    T &value() {
+        if (!ok) {
+            throw BadExpectedAccess();
+        }
+        return val;
+    }
+
+    const T &value() const {
+        if (!ok) {
+            throw BadExpectedAccess();
+        }
+        return val;
+    }
+
+    // Only valid when !hasValue().
+    E &error() {
+        return err;
+    }
+
+    const E &error() const {
+        return err;
+    }
+
+    T valueOr(T fallback) const {
+        return ok ? val : fallback;
+    }
+
+private:
+    template<typename Other>
+    void assign(Other &&other) {
+        static_assert(std::is_nothrow_move_constructible<T>::value || std::is_nothrow_move_constructible<E>::value,
+                      "Expected assignment needs T or E to be nothrow move constructible");
+        if (ok && other.ok) {
+            val = std::forward<Other>(other).val;
+        } else if (!ok && !other.ok) {
+            err = std::forward<Other>(other).err;
+        } else if (other.ok) {
+            replace(val, err, std::forward<Other>(other).val, std::is_nothrow_move_constructible<T>());
+            ok = true;
+        } else {
+            replace(err, val, std::forward<Other>(other).err, std::is_nothrow_move_constructible<E>());
+            ok = false;
+        }
+    }
+
+    // Switches the union from the member from to the member to, built from source. The new
+    // member is built aside first when it can be moved in without throwing; otherwise the
+    // old one is moved aside and put back if building the new one throws.
+    template<typename New, typename Old, typename Source>
+    static void replace(New &to, Old &from, Source &&source, std::true_type) {
+        New built(std::forward<Source>(source));
+        from.~Old();
+        new(&to) New(std::move(built));
+    }
+
+    template<typename New, typename Old, typename Source>
+    static void replace(New &to, Old &from, Source &&source, std::false_type) {
+        Old saved(std::move(from));
+        from.~Old();
+        try {
+            new(&to) New(std::forward<Source>(source));
+        } catch (...) {
+            new(&from) Old(std::move(saved));
+            throw;
+        }
+    }
+
+    void destroy() {
+        if (ok) {
+            val.~T();
+        } else {
+            err.~E();
+        }
+    }
+
+    union {
+        T val;
+        E err;
+    };
+    bool ok;
+};
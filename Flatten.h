@@ -26,12 +26,14 @@ auto flattenSynchronised(const Future<Future<T>> &future) {
     return std::move(flattenSynchronised(std::move(future.get())));
 }
 
+// The thread owns the future, so it outlives the caller's.
 template<typename T>
-auto flatten(const Future<Future<T>> &future) {
+auto flatten(Future<Future<T>> future) {
     std::shared_ptr<Promise<typename NestedTypeGetter<Future<T>>::type_t>> ptr(
             new Promise<typename NestedTypeGetter<Future<T>>::type_t>());
-    std::thread([ptr, &future]() {
-        ptr->set(std::move(flattenSynchronised(std::move(future))));
+    std::shared_ptr<Future<Future<T>>> futurePtr = std::make_shared<Future<Future<T>>>(std::move(future));
+    std::thread([ptr, futurePtr]() {
+        ptr->set(std::move(flattenSynchronised(*futurePtr)));
     }).detach();
     return std::move(ptr->getFuture());
 }
@@ -41,17 +43,27 @@ auto flatten(Future<T> f) {
     return std::move(f);
 }
 
+// Moves the futures out of the collection into the thread that waits for them, so the
+// caller's collection may go away before they are ready.
 template<template<typename ...> class C, typename T>
-Future<C<T>> flatten(C<Future<T> > const &collection) {
+Future<C<T>> flatten(C<Future<T> > &&collection) {
     std::shared_ptr<Promise<C<T>>> ptr(new Promise<C<T>>);
+    std::shared_ptr<C<Future<T>>> futures = std::make_shared<C<Future<T>>>(std::move(collection));
 
-    std::thread([ptr, &collection]() {
+    // get() moves each value out of its future, and the result is moved into the promise,
+    // so elements are never copied.
+    std::thread([ptr, futures]() {
         C<T> returnCollection;
-        for (auto &n: collection) {
+        for (auto &n: *futures) {
             returnCollection.push_back(n.get());
         }
-        ptr->set(returnCollection);
+        ptr->set(std::move(returnCollection));
     }).detach();
 
     return ptr->getFuture();
+}
+
+template<template<typename ...> class C, typename T>
+Future<C<T>> flatten(C<Future<T> > &collection) {
+    return flatten(std::move(collection));
 }
\ No newline at end of file
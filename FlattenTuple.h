@@ -20,18 +20,21 @@ struct NestedTypeGetter<std::tuple<Args...>> {
     typedef std::tuple<typename NestedTypeGetter<Args>::type_t...> type_t;
 };
 
+// The tuple is taken apart in place: plain values and the values of futures are moved into
+// the result, never copied, so move-only and large payloads pass through.
 template<typename T>
-T flatten(const T &future) {
-    return std::move(future);
+T flatten(T &value) {
+    return std::move(value);
 }
 
 template<typename T>
-auto flatten(const Future<T> &future) {
-    return std::move(flatten(std::move(future.get())));
+auto flatten(Future<T> &future) {
+    T value = future.get();
+    return flatten(value);
 }
 
 template<typename ...Args, std::size_t... I>
-auto flatten(const std::tuple<Args...> &tuple, std::index_sequence<I...>) {
+auto flatten(std::tuple<Args...> &tuple, std::index_sequence<I...>) {
     return std::make_tuple(flatten(std::get<I>(tuple))...);
 }
 
@@ -39,9 +42,9 @@ template<class ...tupleParams, typename makeIndexSequence = std::make_index_sequ
 auto flattenTuple(std::tuple<tupleParams...> tuple) {
     using K = typename NestedTypeGetter<std::tuple<tupleParams...>>::type_t;
     std::shared_ptr<Promise<K> > promisePtr(new Promise<K>);
-    std::thread([promisePtr, &tuple]() {
+    std::thread([promisePtr, tuple = std::move(tuple)]() mutable {
         auto t = flatten(tuple, makeIndexSequence{});
-        promisePtr->set(t);
+        promisePtr->set(std::move(t));
     }).detach();
     return promisePtr->getFuture();
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <exception>
+#include <type_traits>
+#include "ThreadPool.h"
+#include "Promise.h"
+#include "Future.h"
+
+// Child of a fork-join computation, meant to live on the forking function's stack.
+// fork() pushes it onto the current worker's deque; join() pops it back and runs it
+// inline unless another worker stole it, in which case join() helps with other jobs
+// until the thief is done. Outside of pool workers fork() does nothing and join() runs
+// the function.
+template<typename F>
+class ForkJoinTask : private ForkJoinJob {
+public:
+    explicit ForkJoinTask(F &function) : function(function), pool(nullptr), done(false) {
+    }
+
+    ForkJoinTask(const ForkJoinTask &) = delete;
+
+    ForkJoinTask &operator=(const ForkJoinTask &) = delete;
+
+    ~ForkJoinTask() {
+        if (pool && !done.load(std::memory_order_acquire)) {
+            join();
+        }
+    }
+
+    void fork() {
+        ThreadPool *current = ThreadPool::localThreadPoolPtr;
+        if (current && current->pushLocal(this)) {
+            pool = current;
+        }
+    }
+
+    void join() {
+        if (!pool) {
+            execute();
+        } else {
+            while (!done.load(std::memory_order_acquire)) {
+                ForkJoinJob *job = pool->popLocal();
+                if (!job) {
+                    job = pool->stealJob();
+                }
+                if (job) {
+                    job->execute();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            pool = nullptr;
+        }
+        if (error) {
+            std::exception_ptr rethrown = error;
+            error = nullptr;
+            std::rethrow_exception(rethrown);
+        }
+    }
+
+private:
+    void execute() override {
+        try {
+            function();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        done.store(true, std::memory_order_release);
+    }
+
+    F &function;
+    ThreadPool *pool;
+    std::atomic<bool> done;
+    std::exception_ptr error;
+};
+
+// Runs both functions, the second one potentially on another worker; returns once both
+// have finished and rethrows the first one's exception, if any.
+template<typename F1, typename F2>
+void forkJoin(F1 &&first, F2 &&second) {
+    ForkJoinTask<typename std::remove_reference<F2>::type> task(second);
+    task.fork();
+    try {
+        first();
+    } catch (...) {
+        task.join();
+        throw;
+    }
+    task.join();
+}
+
+// Runs the root of a fork-join computation on a worker of the pool and blocks until it is done.
+template<typename F>
+void runForkJoin(ThreadPool &pool, F &&function) {
+    if (ThreadPool::localThreadPoolPtr == &pool) {
+        function();
+        return;
+    }
+    std::shared_ptr<Promise<void>> promisePtr = std::make_shared<Promise<void>>();
+    Future<void> future = promisePtr->getFuture();
+    pool.execute([promisePtr, &function]() {
+        try {
+            function();
+            promisePtr->set();
+        } catch (...) {
+            promisePtr->setException(std::current_exception());
+        }
+    });
+    future.get();
+}
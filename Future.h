@@ -17,8 +17,25 @@ class Future {
 
 
 public:
-    ThreadPool *getPool() {
-        return state->threadPool;
+    Executor *getExecutor() {
+        return state->executor;
+    }
+
+    ~Future() {
+        if (state) {
+            state->dropLauncher();
+        }
+    }
+
+    // Schedules the work of a deferred future without waiting for it.
+    void start() const {
+        ensureInitialized();
+        state->start();
+    }
+
+    // True until a deferred future is started.
+    bool isDeferred() const {
+        return state && state->deferred;
     }
 
     Future(Future &&future) noexcept : state(std::move(future.state)), wasUsed(future.wasUsed.load()) {
@@ -26,6 +43,9 @@ public:
     }
 
     Future &operator=(Future &&future) noexcept {
+        if (state && state != future.state) {
+            state->dropLauncher();
+        }
         wasUsed = future.wasUsed.load();
         state = std::move(future.state);
         return *this;
@@ -50,6 +70,57 @@ public:
         }
     }
 
+    // Waits and returns a reference to the value in the shared state, which this future keeps
+    // alive; unlike get() it may be called repeatedly and copies nothing. The reference is
+    // invalidated by get(), getResult() or consume().
+    const T &getRef() const {
+        if (wasUsed) {
+            throw std::runtime_error("get() has already been used");
+        }
+        wait();
+        if (!state->hasPromise && !isReady()) {
+            throw std::runtime_error("Future does not have Promise");
+        } else if (state->exceptionPtr) {
+            std::rethrow_exception(state->exceptionPtr);
+        }
+        return state->value;
+    }
+
+    // Waits and calls function on the value where it lies in the shared state, returning
+    // what function returns. Uses up the future like get().
+    template<typename F>
+    typename std::result_of<F(T &)>::type consume(F &&function) const {
+        if (wasUsed) {
+            throw std::runtime_error("get() has already been used");
+        }
+        wasUsed = true;
+        wait();
+        if (!state->hasPromise && !isReady()) {
+            throw std::runtime_error("Future does not have Promise");
+        } else if (state->exceptionPtr) {
+            std::rethrow_exception(state->exceptionPtr);
+        }
+        return std::forward<F>(function)(state->value);
+    }
+
+    // Like get(), but an exception set on the promise comes back as the error instead of
+    // being rethrown. This is only about exceptions: for a Future<Expected<V, E>> completed
+    // with setError(), the typed E stays inside the stored Expected, which get() already
+    // returns without throwing; getResult() would wrap it once more.
+    Expected<T, std::exception_ptr> getResult() const {
+        if (wasUsed) {
+            throw std::runtime_error("get() has already been used");
+        }
+        wasUsed = true;
+        wait();
+        if (!state->hasPromise && !isReady()) {
+            return unexpected(std::make_exception_ptr(std::runtime_error("Future does not have Promise")));
+        } else if (state->exceptionPtr) {
+            return unexpected(state->exceptionPtr);
+        }
+        return std::move(state->value);
+    }
+
     bool isReady() const {
         ensureInitialized();
         return state->isReady;
@@ -57,24 +128,26 @@ public:
 
     void wait() const {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        state->start();
         if (isReady()) {
             return;
         }
-        state->conditionVariable.wait(lock, [this]() {
-            return isReady() || !state->hasPromise;
-        });
+        state->block();
     }
 
     Future() = default;
 
     friend class Promise<T>;
 
+    friend class SharedFuture<T>;
+
 private:
     std::shared_ptr<FutureState<T> > state;
     mutable std::atomic<bool> wasUsed;
 };
 
+// No getRef(), consume() or getResult() here: get() already returns the reference without
+// copying, and Expected has no reference form.
 template<typename T>
 class Future<T &> {
     explicit Future(std::shared_ptr<FutureState<T &> > state) : state{state}, wasUsed(false) {
@@ -87,11 +160,35 @@ class Future<T &> {
     }
 
 public:
+    Executor *getExecutor() {
+        return state->executor;
+    }
+
+    ~Future() {
+        if (state) {
+            state->dropLauncher();
+        }
+    }
+
+    // Schedules the work of a deferred future without waiting for it.
+    void start() const {
+        ensureInitialized();
+        state->start();
+    }
+
+    // True until a deferred future is started.
+    bool isDeferred() const {
+        return state && state->deferred;
+    }
+
     Future(Future &&f) noexcept : state(std::move(f.state)), wasUsed(f.wasUsed.load()) {
 
     }
 
     Future &operator=(Future &&future) noexcept {
+        if (state && state != future.state) {
+            state->dropLauncher();
+        }
         wasUsed = future.wasUsed.load();
         state = std::move(future.state);
         return *this;
@@ -122,13 +219,11 @@ public:
 
     void wait() const {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        state->start();
         if (isReady()) {
             return;
         }
-        state->conditionVariable.wait(lock, [this]() {
-            return isReady() || !state->hasPromise;
-        });
+        state->block();
     }
 
     friend class Promise<T &>;
@@ -138,6 +233,8 @@ private:
     std::shared_ptr<FutureState<T &> > state;
 };
 
+// No getRef(), consume() or getResult() here: there is no value to refer to, and Expected
+// has no void form.
 template<>
 class Future<void> {
     explicit Future(std::shared_ptr<FutureState<void> > state) : state{state}, wasUsed(false) {
@@ -151,11 +248,35 @@ class Future<void> {
     }
 
 public:
+    Executor *getExecutor() {
+        return state->executor;
+    }
+
+    ~Future() {
+        if (state) {
+            state->dropLauncher();
+        }
+    }
+
+    // Schedules the work of a deferred future without waiting for it.
+    void start() const {
+        ensureInitialized();
+        state->start();
+    }
+
+    // True until a deferred future is started.
+    bool isDeferred() const {
+        return state && state->deferred;
+    }
+
     Future(Future &&f) noexcept : state(std::move(f.state)), wasUsed(f.wasUsed.load()) {
 
     }
 
     Future &operator=(Future &&f) noexcept {
+        if (state && state != f.state) {
+            state->dropLauncher();
+        }
         wasUsed = f.wasUsed.load();
         state = std::move(f.state);
         return *this;
@@ -185,13 +306,11 @@ public:
 
     void wait() const {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        state->start();
         if (isReady()) {
             return;
         }
-        state->conditionVariable.wait(lock, [this]() {
-            return isReady() || !state->hasPromise;
-        });
+        state->block();
 
     }
 
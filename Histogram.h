@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Clock.h"
+
+#ifdef THREADPOOL_HISTOGRAMS
+constexpr bool histogramsEnabled = true;
+#else
+constexpr bool histogramsEnabled = false;
+#endif
+
+struct LatencyPercentiles {
+    uint64_t count = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+// Log-linear bucketing: values below 16 get exact buckets, larger values get 16 linear
+// sub-buckets per power of two, i.e. at most ~6% relative error over the whole range.
+class HistogramBuckets {
+public:
+    enum : size_t {
+        subBucketBits = 4,
+        subBucketCount = size_t(1) << subBucketBits,
+        bucketCount = (64 - subBucketBits + 1) * subBucketCount
+    };
+
+    static size_t index(uint64_t value) {
+        if (value < subBucketCount) {
+            return size_t(value);
+        }
+        size_t exponent = 63 - __builtin_clzll(value);
+        size_t shift = exponent - subBucketBits;
+        size_t subBucket = size_t(value >> shift) & (subBucketCount - 1);
+        return (exponent - subBucketBits + 1) * subBucketCount + subBucket;
+    }
+
+    static uint64_t lowerBound(size_t index) {
+        if (index < subBucketCount) {
+            return index;
+        }
+        size_t shift = index / subBucketCount - 1;
+        return uint64_t(subBucketCount + index % subBucketCount) << shift;
+    }
+
+    static uint64_t upperBound(size_t index) {
+        if (index < subBucketCount) {
+            return index;
+        }
+        size_t shift = index / subBucketCount - 1;
+        return lowerBound(index) + ((uint64_t(1) << shift) - 1);
+    }
+};
+
+// Plain copy of a histogram, in ticks; merge() snapshots of several writers and
+// query percentiles in nanoseconds.
+class HistogramSnapshot {
+public:
+    HistogramSnapshot() : counts(HistogramBuckets::bucketCount, 0), total(0) {
+    }
+
+    void add(size_t bucket, uint64_t count) {
+        counts[bucket] += count;
+        total += count;
+    }
+
+    void merge(const HistogramSnapshot &other) {
+        for (size_t i = 0; i < counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+
+    // Value at the given quantile (0..1) in nanoseconds, taken as the middle of its bucket.
+    double percentile(double quantile) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = uint64_t(quantile * total);
+        if (rank >= total) {
+            rank = total - 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen > rank) {
+                return ticksToNanoseconds(HistogramBuckets::lowerBound(i) / 2 + HistogramBuckets::upperBound(i) / 2);
+            }
+        }
+        return 0;
+    }
+
+    double max() const {
+        for (size_t i = counts.size(); i > 0; i--) {
+            if (counts[i - 1]) {
+                return ticksToNanoseconds(HistogramBuckets::upperBound(i - 1));
+            }
+        }
+        return 0;
+    }
+
+    LatencyPercentiles percentiles() const {
+        LatencyPercentiles result;
+        result.count = total;
+        result.p50 = percentile(0.5);
+        result.p99 = percentile(0.99);
+        result.p999 = percentile(0.999);
+        result.max = max();
+        return result;
+    }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total;
+};
+
+// Histogram with a single writer; snapshot() may run concurrently from any thread.
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts(new std::atomic<uint64_t>[HistogramBuckets::bucketCount]) {
+        for (size_t i = 0; i < HistogramBuckets::bucketCount; i++) {
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void record(uint64_t ticks) {
+        std::atomic<uint64_t> &bucket = counts[HistogramBuckets::index(ticks)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const {
+        HistogramSnapshot result;
+        for (size_t i = 0; i < HistogramBuckets::bucketCount; i++) {
+            uint64_t count = counts[i].load(std::memory_order_relaxed);
+            if (count) {
+                result.add(i, count);
+            }
+        }
+        return result;
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts;
+};
+
+// Per-thread Promise::set -> Future::wait wakeup latencies, merged on demand.
+class FutureWakeupHistograms {
+public:
+    static FutureWakeupHistograms &instance() {
+        static FutureWakeupHistograms histograms;
+        return histograms;
+    }
+
+    // Histogram owned by the calling thread. When the thread exits its counts are folded
+    // into the retired total and the histogram is dropped, so short-lived threads do not
+    // pile up.
+    LatencyHistogram &local() {
+        thread_local Owner owner;
+        if (!owner.histogram) {
+            owner.histogram = std::make_shared<LatencyHistogram>();
+            std::unique_lock<std::mutex> lock(mutex);
+            histograms.push_back(owner.histogram);
+        }
+        return *owner.histogram;
+    }
+
+    HistogramSnapshot snapshot() {
+        std::unique_lock<std::mutex> lock(mutex);
+        HistogramSnapshot result = retired;
+        for (auto &histogram: histograms) {
+            result.merge(histogram->snapshot());
+        }
+        return result;
+    }
+
+    // Number of live per-thread histograms.
+    size_t size() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return histograms.size();
+    }
+
+private:
+    struct Owner {
+        std::shared_ptr<LatencyHistogram> histogram;
+
+        ~Owner() {
+            if (histogram) {
+                instance().retire(histogram);
+            }
+        }
+    };
+
+    void retire(const std::shared_ptr<LatencyHistogram> &histogram) {
+        std::unique_lock<std::mutex> lock(mutex);
+        retired.merge(histogram->snapshot());
+        histograms.erase(std::remove(histograms.begin(), histograms.end(), histogram), histograms.end());
+    }
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<LatencyHistogram>> histograms;
+    HistogramSnapshot retired;
+};
+
+inline HistogramSnapshot futureWakeupHistogram() {
+    return FutureWakeupHistograms::instance().snapshot();
+}
@@ -0,0 +1,391 @@
+#include "IOService.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+BufferSlots::BufferSlots(size_t count, size_t slotSize) : memory(new char[count * slotSize]), slotSize(slotSize) {
+    for (size_t i = count; i > 0; i--) {
+        freeSlots.push_back(unsigned(i - 1));
+    }
+}
+
+Buffer::Buffer(size_t capacity) : bytes(nullptr), length(capacity), bufferCapacity(capacity),
+                                  owned(new char[capacity]), slot(0) {
+    bytes = owned.get();
+}
+
+Buffer::Buffer(std::shared_ptr<BufferSlots> slots, unsigned slot)
+        : bytes(slots->memory.get() + slot * slots->slotSize), length(slots->slotSize),
+          bufferCapacity(slots->slotSize), slots(std::move(slots)), slot(slot) {
+}
+
+Buffer::Buffer(Buffer &&other) noexcept : bytes(other.bytes), length(other.length),
+                                          bufferCapacity(other.bufferCapacity), owned(std::move(other.owned)),
+                                          slots(std::move(other.slots)), slot(other.slot) {
+    other.bytes = nullptr;
+    other.length = other.bufferCapacity = 0;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept {
+    if (this != &other) {
+        release();
+        bytes = other.bytes;
+        length = other.length;
+        bufferCapacity = other.bufferCapacity;
+        owned = std::move(other.owned);
+        slots = std::move(other.slots);
+        slot = other.slot;
+        other.bytes = nullptr;
+        other.length = other.bufferCapacity = 0;
+    }
+    return *this;
+}
+
+void Buffer::resize(size_t size) {
+    length = std::min(size, bufferCapacity);
+}
+
+void Buffer::release() {
+    if (slots) {
+        std::unique_lock<std::mutex> lock(slots->mutex);
+        slots->freeSlots.push_back(slot);
+    }
+    slots.reset();
+    owned.reset();
+    bytes = nullptr;
+    length = bufferCapacity = 0;
+}
+
+void IOService::Request::complete(int64_t result) {
+    if (result < 0) {
+        std::exception_ptr error = std::make_exception_ptr(
+                std::system_error(int(-result), std::generic_category(), operation == Write ? "write" : "read"));
+        if (bufferPromise) {
+            bufferPromise->setException(error);
+        } else if (sizePromise) {
+            sizePromise->setException(error);
+        }
+    } else if (bufferPromise) {
+        buffer.resize(size_t(result));
+        bufferPromise->set(std::move(buffer));
+    } else if (sizePromise) {
+        sizePromise->set(size_t(result));
+    }
+}
+
+#ifdef __linux__
+
+struct IOService::Ring {
+    ~Ring() {
+        if (sqes) {
+            munmap(sqes, sqesSize);
+        }
+        if (rings) {
+            munmap(rings, ringsSize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    // Returns nullptr if the kernel has no usable io_uring. IORING_OP_READ and _WRITE
+    // arrived in 5.6, so the 5.7 fast-poll feature bit stands in for them.
+    static std::unique_ptr<Ring> create(unsigned entries) {
+        std::unique_ptr<Ring> ring(new Ring());
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring->fd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring->fd < 0 || !(params.features & IORING_FEAT_SINGLE_MMAP) ||
+            !(params.features & IORING_FEAT_FAST_POLL)) {
+            return nullptr;
+        }
+        ring->ringsSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                   params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        void *rings = mmap(nullptr, ring->ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring->fd, IORING_OFF_SQ_RING);
+        if (rings == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->rings = static_cast<char *>(rings);
+        ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe *>(sqes);
+        ring->sqHead = reinterpret_cast<unsigned *>(ring->rings + params.sq_off.head);
+        ring->sqTail = reinterpret_cast<unsigned *>(ring->rings + params.sq_off.tail);
+        ring->sqMask = *reinterpret_cast<unsigned *>(ring->rings + params.sq_off.ring_mask);
+        ring->sqArray = reinterpret_cast<unsigned *>(ring->rings + params.sq_off.array);
+        ring->cqHead = reinterpret_cast<unsigned *>(ring->rings + params.cq_off.head);
+        ring->cqTail = reinterpret_cast<unsigned *>(ring->rings + params.cq_off.tail);
+        ring->cqMask = *reinterpret_cast<unsigned *>(ring->rings + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe *>(ring->rings + params.cq_off.cqes);
+        ring->entries = params.sq_entries;
+        return ring;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    // Only called under IOService::mutex, so this thread is the only producer of the tail,
+    // and the only one submitting: the reactor enters with nothing to submit. Returns 0, or
+    // the errno io_uring_enter() failed with, e.g. EAGAIN when the kernel is short of memory;
+    // the entry is then taken back out of the ring, so none are ever left behind.
+    int push(Request *request, int bufferIndex) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->fd = request->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(request->data);
+        sqe->len = unsigned(std::min<size_t>(request->length, UINT_MAX));
+        sqe->off = request->offset;
+        sqe->user_data = reinterpret_cast<uint64_t>(request);
+        if (request->operation == Request::Nop) {
+            sqe->opcode = IORING_OP_NOP;
+        } else if (bufferIndex >= 0) {
+            sqe->opcode = request->operation == Request::Read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+            sqe->buf_index = uint16_t(bufferIndex);
+        } else {
+            sqe->opcode = request->operation == Request::Read ? IORING_OP_READ : IORING_OP_WRITE;
+        }
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        while (true) {
+            int submitted = enter(1, 0, 0);
+            if (submitted > 0) {
+                return 0;
+            }
+            if (submitted < 0 && errno == EINTR) {
+                continue;
+            }
+            int error = submitted < 0 ? errno : EAGAIN;
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+            return error;
+        }
+    }
+
+    int fd = -1;
+    unsigned entries = 0;
+    char *rings = nullptr;
+    size_t ringsSize = 0;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe *cqes = nullptr;
+};
+
+#else
+
+struct IOService::Ring {
+    static std::unique_ptr<Ring> create(unsigned) {
+        return nullptr;
+    }
+
+    int push(Request *, int) {
+        return ENOSYS;
+    }
+
+    int enter(unsigned, unsigned, unsigned) {
+        return -1;
+    }
+
+    unsigned entries = 0;
+};
+
+#endif
+
+IOService::IOService(ThreadPool &pool, IOServiceOptions const &options)
+        : pool(pool), buffersRegistered(false), inFlight(0), capacity(0), stopping(false) {
+    if (options.useIoUring) {
+        ring = Ring::create(unsigned(std::max<size_t>(1, options.queueDepth)));
+    }
+    if (options.registeredBuffers > 0) {
+        slots = std::make_shared<BufferSlots>(options.registeredBuffers, options.registeredBufferSize);
+    }
+    if (ring) {
+        capacity = ring->entries;
+#ifdef __linux__
+        if (slots) {
+            std::vector<iovec> iovecs(options.registeredBuffers);
+            for (size_t i = 0; i < iovecs.size(); i++) {
+                iovecs[i].iov_base = slots->memory.get() + i * slots->slotSize;
+                iovecs[i].iov_len = slots->slotSize;
+            }
+            // Without registration (e.g. over the memlock limit) the buffers still save
+            // the allocations, only the kernel maps them on every request.
+            buffersRegistered = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                                        unsigned(iovecs.size())) == 0;
+        }
+#endif
+        reactor = std::thread([this]() {
+            reactorLoop();
+        });
+    } else {
+        blockingPool.reset(new ThreadPool(std::max<size_t>(1, options.fallbackThreads)));
+    }
+}
+
+IOService::~IOService() {
+    if (ring) {
+        Request *wakeup = new Request{Request::Nop, -1, nullptr, 0, 0, Buffer(), nullptr, nullptr};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        submit(wakeup);
+        reactor.join();
+    }
+    // Runs the blocking requests left in its queue before joining.
+    blockingPool.reset();
+}
+
+Executor *IOService::requestExecutor() {
+    if (ThreadPool::localThreadPoolPtr && ThreadPool::localThreadPoolPtr != blockingPool.get()) {
+        return ThreadPool::localThreadPoolPtr;
+    }
+    return &pool;
+}
+
+Future<Buffer> IOService::read(int fd, size_t length, uint64_t offset) {
+    Buffer buffer;
+    if (slots && length <= slots->slotSize) {
+        std::unique_lock<std::mutex> lock(slots->mutex);
+        if (!slots->freeSlots.empty()) {
+            unsigned slot = slots->freeSlots.back();
+            slots->freeSlots.pop_back();
+            lock.unlock();
+            buffer = Buffer(slots, slot);
+        }
+    }
+    if (!buffer.data()) {
+        buffer = Buffer(length);
+    }
+    std::shared_ptr<Promise<Buffer>> promise = std::make_shared<Promise<Buffer>>();
+    promise->setExecutor(requestExecutor());
+    Future<Buffer> future = promise->getFuture();
+    char *data = buffer.data();
+    submit(new Request{Request::Read, fd, data, length, offset, std::move(buffer), promise, nullptr});
+    return future;
+}
+
+Future<size_t> IOService::read(int fd, void *data, size_t length, uint64_t offset) {
+    std::shared_ptr<Promise<size_t>> promise = std::make_shared<Promise<size_t>>();
+    promise->setExecutor(requestExecutor());
+    Future<size_t> future = promise->getFuture();
+    submit(new Request{Request::Read, fd, static_cast<char *>(data), length, offset, Buffer(), nullptr, promise});
+    return future;
+}
+
+Future<size_t> IOService::write(int fd, const void *data, size_t length, uint64_t offset) {
+    std::shared_ptr<Promise<size_t>> promise = std::make_shared<Promise<size_t>>();
+    promise->setExecutor(requestExecutor());
+    Future<size_t> future = promise->getFuture();
+    submit(new Request{Request::Write, fd, const_cast<char *>(static_cast<const char *>(data)), length, offset,
+                       Buffer(), nullptr, promise});
+    return future;
+}
+
+void IOService::submit(Request *request) {
+    if (!ring) {
+        blockingPool->execute([request]() {
+            int64_t result;
+            do {
+                result = request->operation == Request::Write
+                         ? pwrite(request->fd, request->data, request->length, off_t(request->offset))
+                         : pread(request->fd, request->data, request->length, off_t(request->offset));
+            } while (result < 0 && errno == EINTR);
+            request->complete(result < 0 ? -errno : result);
+            delete request;
+        });
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (inFlight == capacity) {
+        backlog.push_back(request);
+        return;
+    }
+    int error = submitLocked(request);
+    lock.unlock();
+    if (error) {
+        request->complete(-error);
+        delete request;
+    }
+}
+
+int IOService::submitLocked(Request *request) {
+    int bufferIndex = -1;
+    if (buffersRegistered && request->buffer.isRegistered()) {
+        bufferIndex = int(request->buffer.slot);
+    }
+    int error;
+    // The stop wakeup has nobody to report to, and the reactor would not stop without it.
+    while ((error = ring->push(request, bufferIndex)) && request->operation == Request::Nop) {
+        std::this_thread::yield();
+    }
+    if (!error) {
+        inFlight++;
+    }
+    return error;
+}
+
+// Keeps at most capacity requests in the ring, so the completion ring, which the kernel
+// sizes at twice the submission ring, cannot overflow.
+void IOService::reactorLoop() {
+#ifdef __linux__
+    while (true) {
+        ring->enter(0, 1, IORING_ENTER_GETEVENTS);
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        size_t completed = 0;
+        while (head != tail) {
+            io_uring_cqe *cqe = &ring->cqes[head & ring->cqMask];
+            Request *request = reinterpret_cast<Request *>(cqe->user_data);
+            int64_t result = cqe->res;
+            head++;
+            __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+            request->complete(result);
+            delete request;
+            completed++;
+        }
+        std::vector<std::pair<Request *, int>> refused;
+        std::unique_lock<std::mutex> lock(mutex);
+        inFlight -= completed;
+        while (!backlog.empty() && inFlight < capacity) {
+            Request *request = backlog.front();
+            backlog.pop_front();
+            if (int error = submitLocked(request)) {
+                refused.emplace_back(request, error);
+            }
+        }
+        bool stopped = stopping && inFlight == 0;
+        lock.unlock();
+        for (auto &request: refused) {
+            request.first->complete(-request.second);
+            delete request.first;
+        }
+        if (stopped) {
+            return;
+        }
+    }
+#endif
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+#include "Promise.h"
+#include "Future.h"
+
+// Memory of the fixed-size buffers an IOService registers with the kernel, shared with the
+// Buffers that hold one so that it outlives the service.
+struct BufferSlots {
+    BufferSlots(size_t count, size_t slotSize);
+
+    std::unique_ptr<char[]> memory;
+    const size_t slotSize;
+    std::mutex mutex;
+    std::vector<unsigned> freeSlots;
+};
+
+// Bytes read by IOService. Owns either heap memory or one of the service's registered
+// buffers, which goes back to the service when the Buffer is destroyed; moving a Buffer,
+// e.g. out of Future::get(), never copies the bytes.
+class Buffer {
+public:
+    Buffer() : bytes(nullptr), length(0), bufferCapacity(0), slot(0) {
+    }
+
+    explicit Buffer(size_t capacity);
+
+    Buffer(Buffer &&other) noexcept;
+
+    Buffer &operator=(Buffer &&other) noexcept;
+
+    Buffer(const Buffer &) = delete;
+
+    Buffer &operator=(const Buffer &) = delete;
+
+    ~Buffer() {
+        release();
+    }
+
+    char *data() {
+        return bytes;
+    }
+
+    const char *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    size_t capacity() const {
+        return bufferCapacity;
+    }
+
+    // Up to capacity().
+    void resize(size_t size);
+
+    bool isRegistered() const {
+        return slots != nullptr;
+    }
+
+private:
+    friend class IOService;
+
+    Buffer(std::shared_ptr<BufferSlots> slots, unsigned slot);
+
+    void release();
+
+    char *bytes;
+    size_t length;
+    size_t bufferCapacity;
+    std::unique_ptr<char[]> owned;
+    std::shared_ptr<BufferSlots> slots;
+    unsigned slot;
+};
+
+struct IOServiceOptions {
+    // Requests in flight in the kernel; further ones wait in the service until one completes.
+    size_t queueDepth = 128;
+    // Number of registered buffers read(fd, length, offset) can fill without allocating;
+    // reads longer than registeredBufferSize, or made while all are taken, use heap buffers.
+    size_t registeredBuffers = 0;
+    size_t registeredBufferSize = 64 * 1024;
+    // false forces the blocking fallback.
+    bool useIoUring = true;
+    size_t fallbackThreads = 4;
+};
+
+// Reads and writes files through io_uring: requests go into the submission ring from the
+// calling thread and a reactor thread completes their promises as completions arrive, so
+// no pool worker blocks on the disk. Where io_uring is unavailable (non-Linux, old kernels,
+// seccomp) the requests run as blocking pread()/pwrite() calls on a small ThreadPool of
+// fallbackThreads. Futures carry the pool of the requesting worker, or the service's pool
+// for requests from other threads, so Map continuations run there. Errors are reported as
+// std::system_error from Future::get().
+class IOService {
+public:
+    explicit IOService(ThreadPool &pool, IOServiceOptions const &options = IOServiceOptions());
+
+    // Waits for the requests in flight.
+    ~IOService();
+
+    IOService(const IOService &) = delete;
+
+    IOService &operator=(const IOService &) = delete;
+
+    // Reads up to length bytes at offset into a registered buffer if one is free and large
+    // enough, else into a new one. The buffer is resized to the bytes read, 0 at end of file.
+    Future<Buffer> read(int fd, size_t length, uint64_t offset);
+
+    // The memory must stay valid until the future is ready. Returns the bytes read.
+    Future<size_t> read(int fd, void *data, size_t length, uint64_t offset);
+
+    Future<size_t> write(int fd, const void *data, size_t length, uint64_t offset);
+
+    bool usesIoUring() const {
+        return ring != nullptr;
+    }
+
+private:
+    struct Ring;
+
+    struct Request {
+        enum Operation {
+            Read,
+            Write,
+            Nop
+        };
+        Operation operation;
+        int fd;
+        char *data;
+        size_t length;
+        uint64_t offset;
+        Buffer buffer;
+        std::shared_ptr<Promise<Buffer>> bufferPromise;
+        std::shared_ptr<Promise<size_t>> sizePromise;
+
+        // result is a byte count or a negated errno.
+        void complete(int64_t result);
+    };
+
+    Executor *requestExecutor();
+
+    void submit(Request *request);
+
+    // Returns 0, or the errno with which io_uring_enter() refused the request, which is then
+    // no longer in flight and is for the caller to complete once the mutex is released.
+    int submitLocked(Request *request);
+
+    void reactorLoop();
+
+    ThreadPool &pool;
+    std::unique_ptr<Ring> ring;
+    std::unique_ptr<ThreadPool> blockingPool;
+    std::shared_ptr<BufferSlots> slots;
+    bool buffersRegistered;
+    std::mutex mutex;
+    // Requests waiting for room in the ring, and the number in it.
+    std::deque<Request *> backlog;
+    size_t inFlight;
+    size_t capacity;
+    bool stopping;
+    std::thread reactor;
+};
@@ -0,0 +1,86 @@
+#include "LimitedExecutor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+LimitedExecutor::LimitedExecutor(ThreadPool &pool, size_t limit)
+        : pool(pool), maxRunning(std::max<size_t>(1, limit)), running(0), queueHighWaterMark(0), tasksQueued(0),
+          tasksExecuted(0) {
+}
+
+void LimitedExecutor::execute(std::function<void()> const &function) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (running == maxRunning) {
+            pending.push_back(function);
+            tasksQueued++;
+            queueHighWaterMark = std::max(queueHighWaterMark, pending.size());
+            return;
+        }
+        running++;
+    }
+    try {
+        dispatch(function);
+    } catch (RejectedExecutionError &) {
+        // Tasks queued since we took the slot would be stranded without it.
+        std::function<void()> next = finish(false);
+        if (next) {
+            try {
+                dispatch(next);
+            } catch (RejectedExecutionError &) {
+                run(next);
+            }
+        }
+        throw;
+    }
+}
+
+LimitedExecutorStats LimitedExecutor::stats() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    LimitedExecutorStats stats;
+    stats.limit = maxRunning;
+    stats.running = running;
+    stats.queueDepth = pending.size();
+    stats.queueHighWaterMark = queueHighWaterMark;
+    stats.tasksQueued = tasksQueued;
+    stats.tasksExecuted = tasksExecuted;
+    return stats;
+}
+
+void LimitedExecutor::dispatch(std::function<void()> const &function) {
+    std::shared_ptr<LimitedExecutor> self = shared_from_this();
+    pool.execute([self, function]() {
+        self->run(function);
+    });
+}
+
+// A queued task goes back through the pool rather than running here, so that a busy
+// executor does not keep the worker from the pool's other tasks. Only when a bounded
+// pool rejects it does the worker run it itself.
+void LimitedExecutor::run(std::function<void()> function) {
+    while (function) {
+        function();
+        function = finish(true);
+        if (function) {
+            try {
+                dispatch(function);
+                return;
+            } catch (RejectedExecutionError &) {
+            }
+        }
+    }
+}
+
+std::function<void()> LimitedExecutor::finish(bool executed) {
+    std::function<void()> next;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (executed) {
+        tasksExecuted++;
+    }
+    if (pending.empty()) {
+        running--;
+    } else {
+        next = std::move(pending.front());
+        pending.pop_front();
+    }
+    return next;
+}
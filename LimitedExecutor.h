@@ -0,0 +1,53 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "Executor.h"
+#include "Stats.h"
+
+class ThreadPool;
+
+// Bulkhead on a shared ThreadPool: at most limit() of its tasks are in the pool at once.
+// Excess tasks wait in the executor's own queue, not in the pool and not on a worker;
+// whenever one of its tasks finishes, the worker that ran it hands the next queued one
+// to the pool. Created with ThreadPool::limited(); queued tasks keep the executor alive.
+class LimitedExecutor : public Executor, public std::enable_shared_from_this<LimitedExecutor> {
+public:
+    LimitedExecutor(const LimitedExecutor &) = delete;
+
+    LimitedExecutor &operator=(const LimitedExecutor &) = delete;
+
+    // Throws RejectedExecutionError, without queueing the task, if a bounded pool rejects it.
+    void execute(std::function<void()> const &function) override;
+
+    size_t limit() const {
+        return maxRunning;
+    }
+
+    LimitedExecutorStats stats() const;
+
+private:
+    friend class ThreadPool;
+
+    // A limit of 0 is treated as 1.
+    LimitedExecutor(ThreadPool &pool, size_t limit);
+
+    void dispatch(std::function<void()> const &function);
+
+    void run(std::function<void()> function);
+
+    // Counts a finished task and returns the next queued one, which inherits its slot,
+    // or an empty function after giving the slot back.
+    std::function<void()> finish(bool executed);
+
+    ThreadPool &pool;
+    const size_t maxRunning;
+    mutable std::mutex mutex;
+    std::deque<std::function<void()>> pending;
+    size_t running;
+    size_t queueHighWaterMark;
+    uint64_t tasksQueued;
+    uint64_t tasksExecuted;
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#ifdef THREADPOOL_LOCK_PROFILE
+constexpr bool lockProfileEnabled = true;
+#else
+constexpr bool lockProfileEnabled = false;
+#endif
+
+// Where a lock is taken. Execute and WorkerPop take the ThreadPool queue mutex,
+// PromiseSet and FutureWait the mutex of a future's shared state.
+enum class LockSite {
+    Execute,
+    WorkerPop,
+    PromiseSet,
+    FutureWait,
+    Other,
+    Count
+};
+
+struct LockSiteStats {
+    uint64_t acquisitions = 0;
+    uint64_t contendedAcquisitions = 0;
+    uint64_t waitNanoseconds = 0;
+};
+
+class LockProfiler {
+public:
+    static LockSite &currentSite() {
+        thread_local LockSite site = LockSite::Other;
+        return site;
+    }
+
+    static void recordAcquisition(LockSite site) {
+        Counters &counter = counters(site);
+        counter.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void recordContention(LockSite site, uint64_t waitNanoseconds) {
+        Counters &counter = counters(site);
+        counter.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        counter.contendedAcquisitions.fetch_add(1, std::memory_order_relaxed);
+        counter.waitNanoseconds.fetch_add(waitNanoseconds, std::memory_order_relaxed);
+    }
+
+    static LockSiteStats stats(LockSite site) {
+        Counters &counter = counters(site);
+        LockSiteStats result;
+        result.acquisitions = counter.acquisitions.load(std::memory_order_relaxed);
+        result.contendedAcquisitions = counter.contendedAcquisitions.load(std::memory_order_relaxed);
+        result.waitNanoseconds = counter.waitNanoseconds.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    static void reset() {
+        for (size_t i = 0; i < size_t(LockSite::Count); i++) {
+            Counters &counter = counters(LockSite(i));
+            counter.acquisitions = 0;
+            counter.contendedAcquisitions = 0;
+            counter.waitNanoseconds = 0;
+        }
+    }
+
+    static const char *siteName(LockSite site) {
+        switch (site) {
+            case LockSite::Execute:
+                return "ThreadPool::execute";
+            case LockSite::WorkerPop:
+                return "worker pop";
+            case LockSite::PromiseSet:
+                return "Promise::set";
+            case LockSite::FutureWait:
+                return "Future::wait";
+            default:
+                return "other";
+        }
+    }
+
+    // One line per call site: acquisitions, contended acquisitions and time spent waiting.
+    static std::string report() {
+        std::string result;
+        for (size_t i = 0; i < size_t(LockSite::Count); i++) {
+            LockSiteStats site = stats(LockSite(i));
+            result += siteName(LockSite(i));
+            result += ": acquisitions=" + std::to_string(site.acquisitions);
+            result += " contended=" + std::to_string(site.contendedAcquisitions);
+            result += " wait_us=" + std::to_string(site.waitNanoseconds / 1000);
+            if (site.contendedAcquisitions) {
+                result += " avg_wait_ns=" + std::to_string(site.waitNanoseconds / site.contendedAcquisitions);
+            }
+            result += "\n";
+        }
+        return result;
+    }
+
+private:
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contendedAcquisitions{0};
+        std::atomic<uint64_t> waitNanoseconds{0};
+    };
+
+    static Counters &counters(LockSite site) {
+        static Counters perSite[size_t(LockSite::Count)];
+        return perSite[size_t(site)];
+    }
+};
+
+// Sets LockProfiler::currentSite() for its lifetime and then restores the previous one,
+// so a site never leaks into later acquisitions on the same thread.
+class LockSiteScope {
+public:
+    explicit LockSiteScope(LockSite site) : previous(LockProfiler::currentSite()) {
+        LockProfiler::currentSite() = site;
+    }
+
+    LockSiteScope(const LockSiteScope &) = delete;
+
+    LockSiteScope &operator=(const LockSiteScope &) = delete;
+
+    ~LockSiteScope() {
+        LockProfiler::currentSite() = previous;
+    }
+
+private:
+    LockSite previous;
+};
+
+// std::mutex that attributes every acquisition to LockProfiler::currentSite(); a failed
+// try_lock() counts the acquisition as contended and times the blocking lock().
+class ProfiledMutex {
+public:
+    void lock() {
+        LockSite site = LockProfiler::currentSite();
+        if (mutex.try_lock()) {
+            LockProfiler::recordAcquisition(site);
+            heldSite = site;
+            return;
+        }
+        auto startTime = std::chrono::steady_clock::now();
+        mutex.lock();
+        LockProfiler::recordContention(site, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - startTime).count());
+        heldSite = site;
+    }
+
+    bool try_lock() {
+        if (mutex.try_lock()) {
+            heldSite = LockProfiler::currentSite();
+            LockProfiler::recordAcquisition(heldSite);
+            return true;
+        }
+        return false;
+    }
+
+    void unlock() {
+        mutex.unlock();
+    }
+
+    // The site the current holder acquired the mutex for; only valid while holding it.
+    LockSite site() const {
+        return heldSite;
+    }
+
+private:
+    std::mutex mutex;
+    LockSite heldSite = LockSite::Other;
+};
+
+// Waits re-acquire the mutex for the site it was held for when the wait began.
+class ProfiledConditionVariable {
+public:
+    void notify_one() noexcept {
+        conditionVariable.notify_one();
+    }
+
+    void notify_all() noexcept {
+        conditionVariable.notify_all();
+    }
+
+    template<typename ...Args>
+    auto wait(std::unique_lock<ProfiledMutex> &lock, Args &&...args) {
+        LockSiteScope scope(lock.mutex()->site());
+        return conditionVariable.wait(lock, std::forward<Args>(args)...);
+    }
+
+    template<typename ...Args>
+    auto wait_for(std::unique_lock<ProfiledMutex> &lock, Args &&...args) {
+        LockSiteScope scope(lock.mutex()->site());
+        return conditionVariable.wait_for(lock, std::forward<Args>(args)...);
+    }
+
+    template<typename ...Args>
+    auto wait_until(std::unique_lock<ProfiledMutex> &lock, Args &&...args) {
+        LockSiteScope scope(lock.mutex()->site());
+        return conditionVariable.wait_until(lock, std::forward<Args>(args)...);
+    }
+
+private:
+    std::condition_variable_any conditionVariable;
+};
+
+#ifdef THREADPOOL_LOCK_PROFILE
+using InstrumentedMutex = ProfiledMutex;
+using InstrumentedConditionVariable = ProfiledConditionVariable;
+#else
+using InstrumentedMutex = std::mutex;
+using InstrumentedConditionVariable = std::condition_variable;
+#endif
+
+// Takes the lock on behalf of the given call site; InstrumentedConditionVariable waits that
+// re-acquire it are attributed to the same site. Plain locks count as the site around them,
+// LockSite::Other outside any lockAt().
+template<typename M>
+std::unique_lock<M> lockAt(M &mutex, LockSite site) {
+    if (!lockProfileEnabled) {
+        return std::unique_lock<M>(mutex);
+    }
+    LockSiteScope scope(site);
+    return std::unique_lock<M>(mutex);
+}
@@ -1,28 +1,167 @@
+#pragma once
+
 #include <iostream>
 #include "ThreadPool.h"
 #include "Promise.h"
 #include "Future.h"
 
+// Queues the continuation of a Map.
+template<typename T, typename K, typename F>
+void dispatchMap(Executor &executor, const std::shared_ptr<Future<T>> &futurePtr, const F &function,
+                 const std::shared_ptr<Promise<K>> &promisePtr) {
+    Trace::dispatchContinuation();
+    try {
+        executor.execute([futurePtr, function, promisePtr] {
+            try {
+                promisePtr->set(std::move(function(futurePtr->get())));
+            } catch (...) {
+                promisePtr->setException(std::current_exception());
+            }
+        });
+    } catch (RejectedExecutionError &) {
+        promisePtr->setException(std::current_exception());
+    }
+}
+
+// Runs function(future.get()) on the executor; an exception from either fails the returned
+// future. The returned future carries the executor, so Maps chained on it run there too.
+// Over a deferred future the result is deferred as well, and starting it starts the input.
+template<typename T, typename F>
+Future<typename std::result_of<F(T)>::type> Map(Future<T> future, const F &function, Executor &executor) {
+    using K = typename std::result_of<F(T)>::type;
+    std::shared_ptr<Promise<K>> promisePtr = std::shared_ptr<Promise<K>>(new Promise<K>());
+    std::shared_ptr<Future<T>> futurePtr = std::make_shared<Future<T>>(std::move(future));
+
+    promisePtr->setExecutor(&executor);
+    if (futurePtr->isDeferred()) {
+        Executor *executorPtr = &executor;
+        promisePtr->setLauncher([executorPtr, futurePtr, function, promisePtr]() {
+            futurePtr->start();
+            dispatchMap(*executorPtr, futurePtr, function, promisePtr);
+        });
+    } else {
+        dispatchMap(executor, futurePtr, function, promisePtr);
+    }
+    return std::move(promisePtr->getFuture());
+}
+
+// Runs on the future's executor, else on the pool of the calling worker, else on a new thread.
 template<typename T, typename F>
 Future<typename std::result_of<F(T)>::type> Map(Future<T> future, const F &function) {
     using K = typename std::result_of<F(T)>::type;
-    ThreadPool *currentPool = nullptr;
-    if (future.getPool()) {
-        currentPool = future.getPool();
+    Executor *currentExecutor = nullptr;
+    if (future.getExecutor()) {
+        currentExecutor = future.getExecutor();
     } else if (ThreadPool::localThreadPoolPtr) {
-        currentPool = ThreadPool::localThreadPoolPtr;
+        currentExecutor = ThreadPool::localThreadPoolPtr;
+    }
+    if (currentExecutor) {
+        return Map(std::move(future), function, *currentExecutor);
     }
     std::shared_ptr<Promise<K>> promisePtr = std::shared_ptr<Promise<K>>(new Promise<K>());
+    std::shared_ptr<Future<T>> futurePtr = std::make_shared<Future<T>>(std::move(future));
+    std::thread([futurePtr, function, promisePtr]() {
+        try {
+            promisePtr->set(std::move(function(futurePtr->get())));
+        } catch (...) {
+            promisePtr->setException(std::current_exception());
+        }
+    }).detach();
+    return std::move(promisePtr->getFuture());
+}
+
+template<typename R, typename E>
+struct ExpectedResult {
+    typedef Expected<R, E> type;
+};
+
+template<typename U, typename E>
+struct ExpectedResult<Expected<U, E>, E> {
+    typedef Expected<U, E> type;
+};
+
+// Map over a Future<Expected<T, E>> that calls function only on a value and passes an
+// error on untouched. function returns U or Expected<U, E>; the result is Expected<U, E>.
+template<typename T, typename E, typename F>
+Future<typename ExpectedResult<typename std::result_of<F(T)>::type, E>::type>
+MapExpected(Future<Expected<T, E>> future, const F &function, Executor &executor) {
+    using K = typename ExpectedResult<typename std::result_of<F(T)>::type, E>::type;
+    return Map(std::move(future), [function](Expected<T, E> input) -> K {
+        if (!input.hasValue()) {
+            return unexpected(std::move(input.error()));
+        }
+        return function(std::move(input.value()));
+    }, executor);
+}
 
-    if (currentPool) {
-        currentPool->execute([&future, &function, promisePtr] {
-            promisePtr->set(std::move(function(future.get())));
+template<typename T, typename E, typename F>
+Future<typename ExpectedResult<typename std::result_of<F(T)>::type, E>::type>
+MapExpected(Future<Expected<T, E>> future, const F &function) {
+    using K = typename ExpectedResult<typename std::result_of<F(T)>::type, E>::type;
+    return Map(std::move(future), [function](Expected<T, E> input) -> K {
+        if (!input.hasValue()) {
+            return unexpected(std::move(input.error()));
+        }
+        return function(std::move(input.value()));
+    });
+}
 
+// Queues function() on the executor to complete the promise. An exception it throws, or a
+// rejection by the executor, fails the promise instead.
+template<typename K, typename F>
+void executeInto(Executor &executor, const std::shared_ptr<Promise<K>> &promisePtr, const F &function) {
+    try {
+        executor.execute([function, promisePtr] {
+            try {
+                promisePtr->set(function());
+            } catch (...) {
+                promisePtr->setException(std::current_exception());
+            }
         });
-    } else {
-        std::thread([&future, &function, promisePtr]() {
-            promisePtr->set(std::move(function(future.get())));
-        }).detach();
+    } catch (RejectedExecutionError &) {
+        promisePtr->setException(std::current_exception());
     }
-    return std::move(promisePtr->getFuture());
-}
\ No newline at end of file
+}
+
+template<typename F>
+void executeInto(Executor &executor, const std::shared_ptr<Promise<void>> &promisePtr, const F &function) {
+    try {
+        executor.execute([function, promisePtr] {
+            try {
+                function();
+                promisePtr->set();
+            } catch (...) {
+                promisePtr->setException(std::current_exception());
+            }
+        });
+    } catch (RejectedExecutionError &) {
+        promisePtr->setException(std::current_exception());
+    }
+}
+
+// Runs function() on the executor. The returned future carries the executor like Map's.
+template<typename F>
+Future<typename std::result_of<F()>::type> submit(Executor &executor, const F &function) {
+    using K = typename std::result_of<F()>::type;
+    std::shared_ptr<Promise<K>> promisePtr = std::shared_ptr<Promise<K>>(new Promise<K>());
+    promisePtr->setExecutor(&executor);
+    Future<K> future = promisePtr->getFuture();
+    executeInto(executor, promisePtr, function);
+    return future;
+}
+
+// Like submit(), but nothing is queued until the future is first waited on or started;
+// destroying the future before that frees the function without running it. Maps over
+// the future are deferred with it.
+template<typename F>
+Future<typename std::result_of<F()>::type> deferred(Executor &executor, const F &function) {
+    using K = typename std::result_of<F()>::type;
+    std::shared_ptr<Promise<K>> promisePtr = std::shared_ptr<Promise<K>>(new Promise<K>());
+    promisePtr->setExecutor(&executor);
+    Future<K> future = promisePtr->getFuture();
+    Executor *executorPtr = &executor;
+    promisePtr->setLauncher([executorPtr, promisePtr, function]() {
+        executeInto(*executorPtr, promisePtr, function);
+    });
+    return future;
+}
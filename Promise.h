@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include "Expected.h"
 #include "Future.h"
 
 template<typename T>
@@ -12,8 +13,17 @@ class Promise {
     }
 
 public:
-    void setPool(ThreadPool *threadPool) {
-        state->threadPool = threadPool;
+    void setExecutor(Executor *executor) {
+        state->executor = executor;
+    }
+
+    // Makes the future deferred: the launcher runs once, on the first wait(), get() or
+    // start() of the future, and is dropped without running if the future goes first.
+    void setLauncher(std::function<void()> launcher) {
+        ensureInitialized();
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::Other);
+        state->launcher = std::move(launcher);
+        state->deferred = true;
     }
 
     Promise() : state(std::make_shared<FutureState<T> >()), futureExists(false) {
@@ -27,8 +37,10 @@ public:
 
     ~Promise() {
         if (state) {
+            // Under the mutex, so a waiter cannot check hasPromise and then miss the notify.
+            std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::Other);
             state->hasPromise = false;
-            state->conditionVariable.notify_one();
+            state->notifyWaiters();
         }
     }
 
@@ -53,36 +65,39 @@ public:
 
     void set(const T &value) {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->isReady) {
             throw std::runtime_error("value already set");
         }
         state->value = value;
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
 
     }
 
     void set(T &&v) {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->isReady) {
             throw std::runtime_error("value already set");
         }
         state->value = std::move(v);
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
     }
 
     void setException(const std::exception_ptr &exceptionPtr) {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->exceptionPtr) {
             throw std::runtime_error("error already set");
         }
         state->exceptionPtr = exceptionPtr;
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
+    }
+
+    // For a Promise<Expected<V, E>>: completes with an error value, without an exception.
+    template<typename Error>
+    void setError(Error &&error) {
+        set(T(unexpected(std::forward<Error>(error))));
     }
 
 private:
@@ -99,6 +114,18 @@ class Promise<void> {
     }
 
 public:
+    void setExecutor(Executor *executor) {
+        state->executor = executor;
+    }
+
+    // As for Promise<T>.
+    void setLauncher(std::function<void()> launcher) {
+        ensureInitialized();
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::Other);
+        state->launcher = std::move(launcher);
+        state->deferred = true;
+    }
+
     Promise()
             : state(std::make_shared<FutureState<void> >()), futureExists(false) {
         state->hasPromise = true;
@@ -106,8 +133,10 @@ public:
 
     ~Promise() {
         if (state) {
+            // Under the mutex, so a waiter cannot check hasPromise and then miss the notify.
+            std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::Other);
             state->hasPromise = false;
-            state->conditionVariable.notify_one();
+            state->notifyWaiters();
         }
     }
 
@@ -135,22 +164,21 @@ public:
 
     void set() {
         ensureInitialized();
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->isReady) {
             throw std::runtime_error("value already set");
         }
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
     }
 
     void setException(const std::exception_ptr &exceptionPtr) {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->exceptionPtr) {
             throw std::runtime_error("error already set");
         }
         state->exceptionPtr = exceptionPtr;
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
     };
 
 private:
@@ -167,6 +195,18 @@ class Promise<T &> {
     }
 
 public:
+    void setExecutor(Executor *executor) {
+        state->executor = executor;
+    }
+
+    // As for Promise<T>.
+    void setLauncher(std::function<void()> launcher) {
+        ensureInitialized();
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::Other);
+        state->launcher = std::move(launcher);
+        state->deferred = true;
+    }
+
     Promise()
             : state(std::make_shared<FutureState<T &> >()), futureExists(false) {
         state->hasPromise = true;
@@ -174,8 +214,10 @@ public:
 
     ~Promise() {
         if (state) {
+            // Under the mutex, so a waiter cannot check hasPromise and then miss the notify.
+            std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::Other);
             state->hasPromise = false;
-            state->conditionVariable.notify_one();
+            state->notifyWaiters();
         }
     }
 
@@ -203,24 +245,22 @@ public:
 
     void set(T &v) {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->isReady) {
             throw std::runtime_error("value already set");
         }
         state->value = &v;
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
     }
 
     void setException(const std::exception_ptr &exceptionPtr) {
         ensureInitialized();
-        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(state->mutex, LockSite::PromiseSet);
         if (state->exceptionPtr) {
             throw std::runtime_error("error already set");
         }
         state->exceptionPtr = exceptionPtr;
-        state->isReady = true;
-        state->conditionVariable.notify_one();
+        state->markReady();
     }
 
 
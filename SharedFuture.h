@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Promise.h"
+#include "Future.h"
+
+// Copyable view of a Future's result for several consumers: every copy may wait and call
+// get(), which returns a reference to the value kept in the shared state instead of
+// moving it out.
+template<typename T>
+class SharedFuture {
+public:
+    SharedFuture() = default;
+
+    // Starts a deferred future, as its copies cannot tell when the last one is dropped.
+    explicit SharedFuture(Future<T> &&future) : state(std::move(future.state)) {
+        if (state) {
+            state->shared = true;
+            state->start();
+        }
+    }
+
+    const T &get() const {
+        wait();
+        if (!state->hasPromise && !isReady()) {
+            throw std::runtime_error("Future does not have Promise");
+        } else if (state->exceptionPtr) {
+            std::rethrow_exception(state->exceptionPtr);
+        }
+        return state->value;
+    }
+
+    bool isReady() const {
+        ensureInitialized();
+        return state->isReady;
+    }
+
+    // Ready and holding an exception.
+    bool hasException() const {
+        return isReady() && state->exceptionPtr;
+    }
+
+    void wait() const {
+        ensureInitialized();
+        if (isReady()) {
+            return;
+        }
+        state->block();
+    }
+
+    Executor *getExecutor() const {
+        return state->executor;
+    }
+
+    bool operator==(const SharedFuture &other) const {
+        return state == other.state;
+    }
+
+    bool operator!=(const SharedFuture &other) const {
+        return state != other.state;
+    }
+
+private:
+    void ensureInitialized() const {
+        if (!state) {
+            throw std::runtime_error("Future does not have state");
+        }
+    }
+
+    std::shared_ptr<FutureState<T> > state;
+};
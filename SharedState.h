@@ -2,6 +2,8 @@
 
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include "ThreadPool.h"
 
 template<typename>
@@ -10,15 +12,120 @@ class Promise;
 template<typename>
 class Future;
 
+template<typename>
+class SharedFuture;
+
 class State {
 
 public:
-    std::condition_variable conditionVariable;
-    std::mutex mutex;
+    InstrumentedConditionVariable conditionVariable;
+    InstrumentedMutex mutex;
     std::exception_ptr exceptionPtr;
     std::atomic<bool> isReady;
     std::atomic<bool> hasPromise;
-    ThreadPool *threadPool = nullptr;
+    std::atomic<bool> shared{false};
+    // Where Map runs continuations of this future.
+    Executor *executor = nullptr;
+    // Set by Promise::setLauncher for a deferred future; guarded by mutex.
+    std::function<void()> launcher;
+    std::atomic<bool> deferred{false};
+#ifdef THREADPOOL_HISTOGRAMS
+    uint64_t readyAt = 0;
+#endif
+#ifdef THREADPOOL_TRACE
+    uint64_t flowId = 0;
+#endif
+
+    void markReady() {
+#ifdef THREADPOOL_HISTOGRAMS
+        readyAt = readTicks();
+#endif
+#ifdef THREADPOOL_TRACE
+        if (Trace::enabled()) {
+            flowId = Trace::newFlowId();
+            Trace::record(TraceEventType::PromiseSet, flowId, Trace::currentFlowId());
+        }
+#endif
+        isReady = true;
+        notifyWaiters();
+    }
+
+    // Runs the launcher of a deferred future, once.
+    void start() {
+        if (deferred.load(std::memory_order_acquire)) {
+            std::function<void()> launch = takeLauncher();
+            if (launch) {
+                launch();
+            }
+        }
+    }
+
+    // The launcher usually holds the promise of this very state, so an unconsumed deferred
+    // future has to drop it to free the state.
+    void dropLauncher() {
+        if (deferred.load(std::memory_order_acquire)) {
+            takeLauncher();
+        }
+    }
+
+    std::function<void()> takeLauncher() {
+        std::function<void()> taken;
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+        taken.swap(launcher);
+        deferred = false;
+        return taken;
+    }
+
+    // Waits until the value is set or the promise is gone. A pool worker first waits for a
+    // short grace period, and only a longer wait opens a BlockingScope: most futures are set
+    // soon after they are waited on, and those waits should not start compensation workers.
+    void block() {
+        const std::chrono::microseconds blockingGrace(100);
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::FutureWait);
+        if (isReady) {
+            return;
+        }
+        auto done = [this]() {
+            return isReady || !hasPromise;
+        };
+        beforeWait();
+        if (!ThreadPool::localThreadPoolPtr) {
+            conditionVariable.wait(lock, done);
+        } else if (!conditionVariable.wait_for(lock, blockingGrace, done)) {
+            lock.unlock();
+            BlockingScope blockingScope;
+            lock = lockAt(mutex, LockSite::FutureWait);
+            conditionVariable.wait(lock, done);
+        }
+        afterWait();
+    }
+
+    // A SharedFuture may have several waiters, a Future at most one.
+    void notifyWaiters() {
+        if (shared) {
+            conditionVariable.notify_all();
+        } else {
+            conditionVariable.notify_one();
+        }
+    }
+
+    // Called by Future::wait() around a blocking wait, i.e. only when the state was not ready.
+    void beforeWait() {
+#ifdef THREADPOOL_TRACE
+        Trace::record(TraceEventType::FutureWaitBegin, 0, Trace::currentFlowId());
+#endif
+    }
+
+    void afterWait() {
+#ifdef THREADPOOL_HISTOGRAMS
+        if (isReady) {
+            FutureWakeupHistograms::instance().local().record(readTicks() - readyAt);
+        }
+#endif
+#ifdef THREADPOOL_TRACE
+        Trace::record(TraceEventType::FutureWaitEnd, flowId, Trace::currentFlowId());
+#endif
+    }
 };
 
 template<typename T>
@@ -28,6 +135,8 @@ public:
 
     friend class Future<T>;
 
+    friend class SharedFuture<T>;
+
 private:
     T value;
 };
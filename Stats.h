@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef THREADPOOL_STATS
+constexpr bool statsEnabled = true;
+#else
+constexpr bool statsEnabled = false;
+#endif
+
+// Monotonic nanoseconds for the stats counters; returns 0 when stats are compiled out
+// so that the timing code around the worker loop folds away.
+inline uint64_t statsNow() {
+    if (!statsEnabled) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Scheduling lanes of ThreadPool: the three Priority lanes, then tasks submitted with
+// executeBy(). Tasks from execute(), executeOn() and executeOnNode() count as Normal.
+enum class Lane {
+    High,
+    Normal,
+    Low,
+    Deadline,
+    Count
+};
+
+struct WorkerStats {
+    uint64_t tasksExecuted = 0;
+    uint64_t tasksStolen = 0;
+    uint64_t tasksInjected = 0;
+    uint64_t busyNanoseconds = 0;
+    uint64_t idleNanoseconds = 0;
+    uint64_t parkedNanoseconds = 0;
+    uint64_t wakeups = 0;
+    uint64_t spuriousWakeups = 0;
+    uint64_t laneTasks[size_t(Lane::Count)] = {};
+    // Sum of the time from submission to start over the lane's tasks.
+    uint64_t laneWaitNanoseconds[size_t(Lane::Count)] = {};
+
+    WorkerStats &operator+=(const WorkerStats &other) {
+        tasksExecuted += other.tasksExecuted;
+        tasksStolen += other.tasksStolen;
+        tasksInjected += other.tasksInjected;
+        busyNanoseconds += other.busyNanoseconds;
+        idleNanoseconds += other.idleNanoseconds;
+        parkedNanoseconds += other.parkedNanoseconds;
+        wakeups += other.wakeups;
+        spuriousWakeups += other.spuriousWakeups;
+        for (size_t i = 0; i < size_t(Lane::Count); i++) {
+            laneTasks[i] += other.laneTasks[i];
+            laneWaitNanoseconds[i] += other.laneWaitNanoseconds[i];
+        }
+        return *this;
+    }
+};
+
+// Counters of one worker. Only the owning worker writes them, so updates are plain
+// relaxed load/store pairs; stats() may read them concurrently at any time.
+struct alignas(64) WorkerCounters {
+    std::atomic<uint64_t> tasksExecuted{0};
+    std::atomic<uint64_t> tasksStolen{0};
+    std::atomic<uint64_t> tasksInjected{0};
+    std::atomic<uint64_t> busyNanoseconds{0};
+    std::atomic<uint64_t> idleNanoseconds{0};
+    std::atomic<uint64_t> parkedNanoseconds{0};
+    std::atomic<uint64_t> wakeups{0};
+    std::atomic<uint64_t> spuriousWakeups{0};
+    std::atomic<uint64_t> laneTasks[size_t(Lane::Count)] = {};
+    std::atomic<uint64_t> laneWaitNanoseconds[size_t(Lane::Count)] = {};
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+        if (statsEnabled) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    }
+
+    WorkerStats snapshot() const {
+        WorkerStats stats;
+        stats.tasksExecuted = tasksExecuted.load(std::memory_order_relaxed);
+        stats.tasksStolen = tasksStolen.load(std::memory_order_relaxed);
+        stats.tasksInjected = tasksInjected.load(std::memory_order_relaxed);
+        stats.busyNanoseconds = busyNanoseconds.load(std::memory_order_relaxed);
+        stats.idleNanoseconds = idleNanoseconds.load(std::memory_order_relaxed);
+        stats.parkedNanoseconds = parkedNanoseconds.load(std::memory_order_relaxed);
+        stats.wakeups = wakeups.load(std::memory_order_relaxed);
+        stats.spuriousWakeups = spuriousWakeups.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < size_t(Lane::Count); i++) {
+            stats.laneTasks[i] = laneTasks[i].load(std::memory_order_relaxed);
+            stats.laneWaitNanoseconds[i] = laneWaitNanoseconds[i].load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+};
+
+struct LaneStats {
+    size_t queueDepth = 0;
+    // Counted by the workers, so zero unless THREADPOOL_STATS is defined.
+    uint64_t tasksExecuted = 0;
+    uint64_t waitNanoseconds = 0;
+};
+
+struct ThreadPoolStats {
+    // One entry per worker slot, including the idle slots of an elastic pool.
+    std::vector<WorkerStats> workers;
+    // Summed over the compensation worker slots, which are not listed in workers.
+    WorkerStats compensation;
+    WorkerStats total;
+    size_t activeWorkers = 0;
+    // Workers inside a BlockingScope; they are counted in activeWorkers too.
+    size_t blockedWorkers = 0;
+    size_t queueDepth = 0;
+    size_t queueHighWaterMark = 0;
+    // 0 for an unbounded queue.
+    size_t queueCapacity = 0;
+    uint64_t rejectedTasks = 0;
+    uint64_t droppedTasks = 0;
+    uint64_t callerRunTasks = 0;
+    // Indexed by Lane.
+    LaneStats lanes[size_t(Lane::Count)];
+};
+
+struct LimitedExecutorStats {
+    size_t limit = 0;
+    size_t running = 0;
+    // Tasks held back by the executor because all of its slots were taken.
+    size_t queueDepth = 0;
+    size_t queueHighWaterMark = 0;
+    uint64_t tasksQueued = 0;
+    uint64_t tasksExecuted = 0;
+};
+
+struct AsyncCacheStats {
+    size_t size = 0;
+    uint64_t hits = 0;
+    // Callers that attached to a computation still in flight.
+    uint64_t joins = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t expirations = 0;
+    uint64_t failures = 0;
+};
+
+// One node of the last TaskGraph run; times are nanoseconds since the run started.
+struct TaskGraphNodeTiming {
+    std::string name;
+    double startNs = 0;
+    double finishNs = 0;
+    // Hash of the id of the thread that ran the node.
+    uint64_t thread = 0;
+    // Not run because an earlier node threw.
+    bool skipped = false;
+};
@@ -0,0 +1,218 @@
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <stdexcept>
+#include <thread>
+
+TaskGraph::TaskGraph(ThreadPool &pool)
+        : pool(pool), validated(true), unfinished(0), failed(false), runStartTicks(0), running(false) {
+}
+
+TaskGraph::~TaskGraph() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() {
+        return !running;
+    });
+}
+
+TaskGraph::Node TaskGraph::add(std::function<void()> function, std::string name) {
+    checkIdle();
+    Node node = nodes.size();
+    std::unique_ptr<NodeData> data(new NodeData());
+    data->function = std::move(function);
+    data->dispatch = [this, node]() {
+        runFrom(node);
+    };
+    data->name = name.empty() ? "node " + std::to_string(node) : std::move(name);
+    nodes.push_back(std::move(data));
+    validated = false;
+    return node;
+}
+
+void TaskGraph::precede(Node before, Node after) {
+    checkIdle();
+    if (before >= nodes.size() || after >= nodes.size()) {
+        throw std::out_of_range("TaskGraph node does not exist");
+    }
+    nodes[before]->successors.push_back(after);
+    nodes[after]->predecessors++;
+    validated = false;
+}
+
+Future<void> TaskGraph::run() {
+    std::shared_ptr<Promise<void>> runPromise = std::make_shared<Promise<void>>();
+    runPromise->setExecutor(&pool);
+    Future<void> future = runPromise->getFuture();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (running) {
+            throw std::logic_error("TaskGraph is already running");
+        }
+        if (!validated) {
+            if (!findRoots()) {
+                throw std::logic_error("TaskGraph has a cycle");
+            }
+            validated = true;
+        }
+        if (nodes.empty()) {
+            runPromise->set();
+            return future;
+        }
+        running = true;
+    }
+    for (auto &node: nodes) {
+        node->remaining.store(node->predecessors, std::memory_order_relaxed);
+        node->skipped = false;
+    }
+    unfinished.store(nodes.size(), std::memory_order_relaxed);
+    failed.store(false, std::memory_order_relaxed);
+    promise = std::move(runPromise);
+    runStartTicks = readTicks();
+    // The last root may finish the run, after which roots must not be touched.
+    size_t rootCount = roots.size();
+    Node last = roots[rootCount - 1];
+    for (size_t i = 0; i + 1 < rootCount; i++) {
+        schedule(roots[i]);
+    }
+    schedule(last);
+    return future;
+}
+
+std::vector<TaskGraphNodeTiming> TaskGraph::timings() const {
+    std::vector<TaskGraphNodeTiming> result;
+    result.reserve(nodes.size());
+    for (auto &node: nodes) {
+        TaskGraphNodeTiming timing;
+        timing.name = node->name;
+        timing.skipped = node->skipped;
+        timing.thread = node->thread;
+        if (node->startTicks >= runStartTicks) {
+            timing.startNs = ticksToNanoseconds(node->startTicks - runStartTicks);
+            timing.finishNs = ticksToNanoseconds(node->finishTicks - runStartTicks);
+        }
+        result.push_back(timing);
+    }
+    return result;
+}
+
+void TaskGraph::dumpChromeTrace(std::ostream &out) const {
+    bool first = true;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (auto &timing: timings()) {
+        if (timing.skipped) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":";
+        Trace::writeJsonString(out, timing.name);
+        out << ",\"cat\":\"taskgraph\",\"ph\":\"X\",\"ts\":"
+            << timing.startNs / 1000.0 << ",\"dur\":" << (timing.finishNs - timing.startNs) / 1000.0
+            << ",\"pid\":1,\"tid\":" << timing.thread << "}";
+    }
+    out << "\n]}\n";
+}
+
+void TaskGraph::checkIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (running) {
+        throw std::logic_error("TaskGraph cannot change while running");
+    }
+}
+
+bool TaskGraph::findRoots() {
+    roots.clear();
+    std::vector<size_t> remaining(nodes.size());
+    std::vector<Node> ready;
+    for (Node node = 0; node < nodes.size(); node++) {
+        remaining[node] = nodes[node]->predecessors;
+        if (remaining[node] == 0) {
+            roots.push_back(node);
+            ready.push_back(node);
+        }
+    }
+    size_t visited = 0;
+    while (!ready.empty()) {
+        Node node = ready.back();
+        ready.pop_back();
+        visited++;
+        for (Node successor: nodes[node]->successors) {
+            if (--remaining[successor] == 0) {
+                ready.push_back(successor);
+            }
+        }
+    }
+    return visited == nodes.size();
+}
+
+void TaskGraph::schedule(Node node) {
+    try {
+        pool.execute(nodes[node]->dispatch);
+    } catch (RejectedExecutionError &) {
+        runFrom(node);
+    }
+}
+
+// Runs the node, then keeps going with the last successor it readied instead of queueing
+// it; the other readied successors go to the pool. A node still counts as unfinished until
+// its successors are readied, so the run cannot complete under a task that is using it.
+void TaskGraph::runFrom(Node node) {
+    uint64_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    while (true) {
+        NodeData &data = *nodes[node];
+        data.thread = thread;
+        data.startTicks = readTicks();
+        if (failed.load(std::memory_order_acquire)) {
+            data.skipped = true;
+        } else {
+            try {
+                data.function();
+            } catch (...) {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_release);
+            }
+        }
+        data.finishTicks = readTicks();
+        bool hasNext = false;
+        Node next = 0;
+        for (Node successor: data.successors) {
+            if (nodes[successor]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (hasNext) {
+                    schedule(next);
+                }
+                next = successor;
+                hasNext = true;
+            }
+        }
+        if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            finishRun();
+            return;
+        }
+        if (!hasNext) {
+            return;
+        }
+        node = next;
+    }
+}
+
+// Nothing of the graph is touched after running is cleared, as the owner may then run it
+// again or destroy it.
+void TaskGraph::finishRun() {
+    std::shared_ptr<Promise<void>> finished = std::move(promise);
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        failure = error;
+        error = nullptr;
+        running = false;
+        idle.notify_all();
+    }
+    if (failure) {
+        finished->setException(failure);
+    } else {
+        finished->set();
+    }
+}
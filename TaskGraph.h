@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Promise.h"
+#include "Future.h"
+#include "Stats.h"
+
+class ThreadPool;
+
+// Reusable graph of tasks on a ThreadPool, with the dependencies declared up front. Each
+// node counts its unfinished predecessors in an atomic; the task that finishes a node's
+// last predecessor queues it on the pool, or runs it itself if it is the last node that
+// task readied, so no worker ever blocks waiting for an input. A run resets the counters
+// in place and queues nodes through closures built in add(), so nothing is allocated per
+// node by the graph itself; a run still allocates its completion promise and shared state,
+// and the pool's queue may allocate to hold the dispatched nodes.
+//
+// Once a node throws, nodes that have not started yet are skipped and the run's future
+// fails with the first exception. Nodes and edges may only be added while no run is in
+// progress; the destructor waits for the current run.
+class TaskGraph {
+public:
+    typedef size_t Node;
+
+    explicit TaskGraph(ThreadPool &pool);
+
+    TaskGraph(const TaskGraph &) = delete;
+
+    TaskGraph &operator=(const TaskGraph &) = delete;
+
+    ~TaskGraph();
+
+    // The name labels the node in timings(); it defaults to "node <index>".
+    Node add(std::function<void()> function, std::string name = std::string());
+
+    // after starts only once before has finished.
+    void precede(Node before, Node after);
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+    // Throws std::logic_error if the previous run is still in progress or the edges form
+    // a cycle.
+    Future<void> run();
+
+    // Of the last run, once its future is ready.
+    std::vector<TaskGraphNodeTiming> timings() const;
+
+    // The last run as Chrome trace events, one complete event per node that ran.
+    void dumpChromeTrace(std::ostream &out) const;
+
+private:
+    struct NodeData {
+        std::function<void()> function;
+        // Queued on the pool to run the node; built once in add().
+        std::function<void()> dispatch;
+        std::string name;
+        std::vector<Node> successors;
+        size_t predecessors = 0;
+        std::atomic<size_t> remaining{0};
+        uint64_t startTicks = 0;
+        uint64_t finishTicks = 0;
+        uint64_t thread = 0;
+        bool skipped = false;
+    };
+
+    void checkIdle();
+
+    // Kahn's algorithm over the predecessor counts; fills roots.
+    bool findRoots();
+
+    void schedule(Node node);
+
+    void runFrom(Node node);
+
+    void finishRun();
+
+    ThreadPool &pool;
+    std::vector<std::unique_ptr<NodeData>> nodes;
+    std::vector<Node> roots;
+    bool validated;
+    std::atomic<size_t> unfinished;
+    std::atomic<bool> failed;
+    std::shared_ptr<Promise<void>> promise;
+    uint64_t runStartTicks;
+    mutable std::mutex mutex;
+    std::condition_variable idle;
+    bool running;
+    std::exception_ptr error;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include "ThreadPool.h"
+
+// Structured group of child tasks on a ThreadPool. Children are kept in the group's own
+// queue and counted by a single atomic; each run() enqueues one trampoline into the pool
+// that takes the next child, while wait() drains the remaining children on the calling
+// thread before blocking.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool &pool, bool cancelOnError = false)
+            : pool(pool), shared(std::make_shared<Shared>(cancelOnError)) {
+    }
+
+    TaskGroup(const TaskGroup &) = delete;
+
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    ~TaskGroup() {
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+
+    template<typename F>
+    void run(F &&function) {
+        shared->outstanding.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            shared->pending.emplace_back(std::forward<F>(function));
+        }
+        std::shared_ptr<Shared> group = shared;
+        // A trampoline rejected by a bounded pool is fine: wait() runs the child instead.
+        try {
+            pool.execute([group]() {
+                group->runNext(false);
+            });
+        } catch (RejectedExecutionError &) {
+        }
+    }
+
+    // Waits for all children, rethrowing the first exception any of them threw.
+    void wait() {
+        while (shared->runNext(true)) {
+        }
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->conditionVariable.wait(lock, [this]() {
+            return shared->outstanding.load(std::memory_order_acquire) == 0;
+        });
+        std::exception_ptr error = shared->error;
+        shared->error = nullptr;
+        shared->cancelled = false;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Children that have not started yet are skipped; running ones are not interrupted.
+    void cancel() {
+        shared->cancelled = true;
+    }
+
+    bool isCancelled() const {
+        return shared->cancelled;
+    }
+
+private:
+    struct Shared {
+        explicit Shared(bool cancelOnError) : outstanding(0), cancelled(false), cancelOnError(cancelOnError) {
+        }
+
+        // Runs one queued child: the oldest one for pool trampolines, the newest one for
+        // the waiting thread. Returns false if there was nothing left to run.
+        bool runNext(bool newest) {
+            std::function<void()> function;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (pending.empty()) {
+                    return false;
+                }
+                if (newest) {
+                    function = std::move(pending.back());
+                    pending.pop_back();
+                } else {
+                    function = std::move(pending.front());
+                    pending.pop_front();
+                }
+            }
+            if (!cancelled) {
+                try {
+                    function();
+                } catch (...) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    if (cancelOnError) {
+                        cancelled = true;
+                    }
+                }
+            }
+            if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::unique_lock<std::mutex> lock(mutex);
+                conditionVariable.notify_all();
+            }
+            return true;
+        }
+
+        std::mutex mutex;
+        std::condition_variable conditionVariable;
+        std::deque<std::function<void()>> pending;
+        std::atomic<size_t> outstanding;
+        std::atomic<bool> cancelled;
+        std::exception_ptr error;
+        const bool cancelOnError;
+    };
+
+    ThreadPool &pool;
+    std::shared_ptr<Shared> shared;
+};
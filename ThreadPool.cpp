@@ -1,36 +1,899 @@
 #include "ThreadPool.h"
+#include "LimitedExecutor.h"
+#include <algorithm>
 
-ThreadPool::ThreadPool(size_t num_thread) : working(false) {
-    for (size_t i = 0; i < num_thread; i++) {
-        threads.emplace_back([this]() {
-            localThreadPoolPtr = this;
-            while (true) {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(mutex);
-                    conditionVariable.wait(lock, [this]() {
-                        return !queue.empty() || working;
-                    });
-                    if (working && queue.empty()) return;
-                    task = std::move(queue.front());
-                    queue.pop();
+static size_t compensationSlots(size_t workers, ThreadPoolOptions const &options) {
+    if (options.maxCompensationWorkers == ThreadPoolOptions::oneSlotPerWorker) {
+        return std::min<size_t>(workers, 8);
+    }
+    return options.maxCompensationWorkers;
+}
+
+ThreadPool::ThreadPool(size_t num_thread) : ThreadPool(num_thread, ThreadPoolOptions()) {
+}
+
+ThreadPool::ThreadPool(size_t num_thread, ThreadPoolOptions const &options)
+        : boundedQueue(options.queueCapacity > 0 ? makeAligned<BoundedQueue<Task>>(options.queueCapacity) : nullptr),
+          overflowPolicy(options.overflowPolicy), blockedProducers(0), rejectedTasks(0), droppedTasks(0),
+          callerRunTasks(0), affinityTimeout(options.affinityTimeout),
+          workerCount(std::max(num_thread, options.maxWorkers) +
+                      compensationSlots(std::max(num_thread, options.maxWorkers), options)), nodeCount(0),
+          scheduledSize(0), scheduledSequence(0),
+          agingNanoseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(options.agingThreshold).count()),
+          normalPassedOverSince(0), queueDepth(0), queueHighWaterMark(0), working(false), shutdownStarted(false), parkedWorkers(0), liveWorkers(0),
+          targetWorkers(num_thread), blockedWorkers(0), spareWorkers(0),
+          minWorkers(std::max<size_t>(1, std::min(options.minWorkers, num_thread))),
+          maxWorkers(std::max(num_thread, options.maxWorkers)), elastic(options.maxWorkers > 0), keepAlive(options.keepAlive), watcherWakeTick(UINT64_MAX),
+          watcherParked(false) {
+    for (auto &depth: scheduledLaneDepth) {
+        depth.store(0, std::memory_order_relaxed);
+    }
+    workers = makeAlignedArray<Worker>(workerCount);
+    counters = makeAlignedArray<WorkerCounters>(workerCount);
+    if (histogramsEnabled) {
+        histograms.reset(new WorkerHistograms[workerCount]);
+    }
+    threads.resize(workerCount);
+    placeWorkers(options);
+    {
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+        for (size_t i = 0; i < num_thread; i++) {
+            spawnWorkerLocked();
+        }
+    }
+    if (elastic) {
+        supervisor = std::thread([this, options]() {
+            supervisorLoop(options.growAfter, options.growQueueDepth);
+        });
+    }
+}
+
+bool ThreadPool::spawnWorkerLocked() {
+    for (size_t i = 0; i < workerCount; i++) {
+        if (!workers[i].running) {
+            // A retired worker has released the mutex for good, so it is only exiting.
+            if (threads[i].joinable()) {
+                threads[i].join();
+            }
+            workers[i].running = true;
+            liveWorkers++;
+            threads[i] = std::thread([this, i]() {
+                workerLoop(i);
+            });
+            return true;
+        }
+    }
+    return false;
+}
+
+// Samples the backlog a few times per growAfter; growing and joining retired workers
+// happen here so that neither execute() nor the worker loop pays for them.
+void ThreadPool::supervisorLoop(std::chrono::steady_clock::duration growAfter, size_t growQueueDepth) {
+    std::chrono::steady_clock::duration interval = std::max<std::chrono::steady_clock::duration>(
+            growAfter / 4, std::chrono::milliseconds(1));
+    std::chrono::steady_clock::time_point backlogSince = std::chrono::steady_clock::time_point::max();
+    std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+    while (!working) {
+        supervisorWakeup.wait_for(lock, interval);
+        std::vector<std::thread> retired;
+        for (size_t i = 0; i < workerCount; i++) {
+            if (!workers[i].running && threads[i].joinable()) {
+                retired.push_back(std::move(threads[i]));
+            }
+        }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (working || pendingTasks() < growQueueDepth || parkedWorkers > 0) {
+            backlogSince = std::chrono::steady_clock::time_point::max();
+        } else if (backlogSince == std::chrono::steady_clock::time_point::max()) {
+            backlogSince = now;
+        } else if (now - backlogSince >= growAfter && targetWorkers < maxWorkers && spawnWorkerLocked()) {
+            targetWorkers++;
+            backlogSince = now;
+        }
+        if (!retired.empty()) {
+            lock.unlock();
+            for (auto &thread: retired) {
+                thread.join();
+            }
+            lock.lock();
+        }
+    }
+}
+
+size_t ThreadPool::pendingTasks() const {
+    size_t pending = boundedQueue ? boundedQueue->size() : queueDepth.load(std::memory_order_relaxed);
+    pending += scheduledSize.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < nodeCount; i++) {
+        pending += nodeQueues[i].size.load(std::memory_order_relaxed);
+    }
+    return pending;
+}
+
+void ThreadPool::placeWorkers(ThreadPoolOptions const &options) {
+    const Topology &topology = options.topology ? *options.topology : Topology::system();
+    nodeCount = topology.nodes().size();
+    nodeQueues.reset(new NodeQueue[nodeCount]);
+    for (auto &node: topology.nodes()) {
+        nodeIds.push_back(node.id);
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        Worker &worker = workers[i];
+        switch (options.placement) {
+            case WorkerPlacement::None:
+                break;
+            case WorkerPlacement::CpuSet:
+                worker.cpus = options.cpuSet;
+                break;
+            case WorkerPlacement::PerCore:
+                worker.cpus = {topology.cores()[i % topology.cores().size()]};
+                break;
+            case WorkerPlacement::PerNode:
+                worker.cpus = topology.nodes()[i % nodeCount].cpus;
+                break;
+        }
+        if (!worker.cpus.empty()) {
+            worker.node = topology.nodeIndexOfCpu(worker.cpus.front());
+        }
+    }
+}
+
+// Workers take work from their own deque first, then from their inbox, their node's
+// queue and the shared queue, then steal fork-join jobs, other nodes' tasks and stale
+// inbox tasks, and park only once all of those are empty.
+void ThreadPool::workerLoop(size_t index) {
+    localThreadPoolPtr = this;
+    localWorkerIndex = index;
+    if (!workers[index].cpus.empty()) {
+        pinCurrentThread(workers[index].cpus);
+    }
+    Trace::setThreadName("ThreadPool worker " + std::to_string(index));
+    WorkerCounters &counter = counters[index];
+    uint64_t idleSince = statsNow();
+    while (true) {
+        if (ForkJoinJob *job = workers[index].deque.pop()) {
+            runJob(job, counter, false);
+            continue;
+        }
+        if (overTarget() && !retireSurplus(index)) {
+            return;
+        }
+        Task task;
+        Lane lane;
+        if (popInbox(index, task)) {
+            runTask(index, task, idleSince);
+            continue;
+        }
+        if (popScheduled(task, lane)) {
+            runTask(index, task, idleSince, lane);
+            continue;
+        }
+        if (popNodeQueue(workers[index].node, task) || popQueue(task)) {
+            WorkerCounters::add(counter.tasksInjected, 1);
+            runTask(index, task, idleSince);
+            continue;
+        }
+        if (ForkJoinJob *job = stealJob()) {
+            runJob(job, counter, true);
+            continue;
+        }
+        if (stealNodeQueue(index, task)) {
+            WorkerCounters::add(counter.tasksStolen, 1);
+            runTask(index, task, idleSince);
+            continue;
+        }
+        if (stealInbox(index, task)) {
+            WorkerCounters::add(counter.tasksStolen, 1);
+            runTask(index, task, idleSince);
+            continue;
+        }
+        if (!park(index, idleSince)) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popQueue(Task &task) {
+    if (boundedQueue) {
+        if (!boundedQueue->tryPop(task)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (blockedProducers.load(std::memory_order_relaxed) > 0) {
+            std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::WorkerPop);
+            spaceAvailable.notify_all();
+        }
+    } else {
+        if (queueDepth.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::WorkerPop);
+        if (queue.empty()) {
+            return false;
+        }
+        task = std::move(queue.front());
+        queue.pop();
+        queueDepth.store(queue.size(), std::memory_order_relaxed);
+    }
+    if (normalPassedOverSince.load(std::memory_order_relaxed) != 0) {
+        normalPassedOverSince.store(0, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// Serves the earliest ranked scheduled task, unless the Normal lane has been passed over
+// for agingThreshold, in which case the caller falls through to it.
+bool ThreadPool::popScheduled(Task &task, Lane &lane) {
+    if (scheduledSize.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    bool normalWaiting = boundedQueue ? !boundedQueue->empty() : queueDepth.load(std::memory_order_relaxed) > 0;
+    if (normalWaiting) {
+        uint64_t now = steadyNanoseconds();
+        uint64_t since = normalPassedOverSince.load(std::memory_order_relaxed);
+        if (since == 0) {
+            normalPassedOverSince.compare_exchange_strong(since, now, std::memory_order_relaxed);
+        } else if (now - since >= agingNanoseconds) {
+            return false;
+        }
+    }
+    std::unique_lock<std::mutex> lock(scheduledMutex);
+    if (scheduled.empty()) {
+        return false;
+    }
+    std::pop_heap(scheduled.begin(), scheduled.end());
+    task = std::move(scheduled.back().task);
+    lane = scheduled.back().lane;
+    scheduled.pop_back();
+    scheduledLaneDepth[size_t(lane)].fetch_sub(1, std::memory_order_relaxed);
+    scheduledSize.store(scheduled.size(), std::memory_order_release);
+    return true;
+}
+
+void ThreadPool::schedule(Task &&task, uint64_t rank, Lane lane) {
+    if (isShutdown()) {
+        throw RejectedExecutionError("ThreadPool is shut down");
+    }
+    {
+        std::unique_lock<std::mutex> lock(scheduledMutex);
+        scheduled.push_back(ScheduledTask{std::move(task), rank, scheduledSequence++, lane});
+        std::push_heap(scheduled.begin(), scheduled.end());
+        scheduledLaneDepth[size_t(lane)].fetch_add(1, std::memory_order_relaxed);
+        scheduledSize.store(scheduled.size(), std::memory_order_release);
+    }
+    // Pairs with the increment of parkedWorkers before a worker checks the queues.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parkedWorkers.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Execute);
+        conditionVariable.notify_one();
+    }
+}
+
+void ThreadPool::execute(Priority priority, std::function<void()> const &function) {
+    switch (priority) {
+        case Priority::High:
+            schedule(makeTask(function), steadyNanoseconds(), Lane::High);
+            break;
+        case Priority::Normal:
+            execute(function);
+            break;
+        case Priority::Low:
+            schedule(makeTask(function), steadyNanoseconds() + agingNanoseconds, Lane::Low);
+            break;
+    }
+}
+
+void ThreadPool::executeBy(std::chrono::steady_clock::time_point deadline, std::function<void()> const &function) {
+    uint64_t rank = uint64_t(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline.time_since_epoch()).count()));
+    schedule(makeTask(function), rank, Lane::Deadline);
+}
+
+bool ThreadPool::popNodeQueue(size_t node, Task &task) {
+    NodeQueue &nodeQueue = nodeQueues[node];
+    if (nodeQueue.size.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(nodeQueue.mutex);
+    if (nodeQueue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(nodeQueue.tasks.front());
+    nodeQueue.tasks.pop_front();
+    nodeQueue.size.store(nodeQueue.tasks.size(), std::memory_order_release);
+    return true;
+}
+
+bool ThreadPool::stealNodeQueue(size_t index, Task &task) {
+    for (size_t i = 1; i < nodeCount; i++) {
+        if (popNodeQueue((workers[index].node + i) % nodeCount, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::popInbox(size_t index, Task &task) {
+    Worker &worker = workers[index];
+    if (worker.inboxSize.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(worker.inboxMutex);
+    if (worker.inbox.empty()) {
+        return false;
+    }
+    task = std::move(worker.inbox.front().task);
+    worker.inbox.pop_front();
+    worker.inboxSize.store(worker.inbox.size(), std::memory_order_release);
+    return true;
+}
+
+bool ThreadPool::stealInbox(size_t index, Task &task) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 1; i < workerCount; i++) {
+        Worker &victim = workers[(index + i) % workerCount];
+        if (victim.inboxSize.load(std::memory_order_acquire) == 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(victim.inboxMutex);
+        if (!victim.inbox.empty() && victim.inbox.front().staleAt <= now) {
+            task = std::move(victim.inbox.front().task);
+            victim.inbox.pop_front();
+            victim.inboxSize.store(victim.inbox.size(), std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::chrono::steady_clock::time_point ThreadPool::nextStaleInboxTask(size_t index) {
+    std::chrono::steady_clock::time_point earliest = std::chrono::steady_clock::time_point::max();
+    for (size_t i = 1; i < workerCount; i++) {
+        Worker &victim = workers[(index + i) % workerCount];
+        if (victim.inboxSize.load(std::memory_order_acquire) == 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(victim.inboxMutex);
+        if (!victim.inbox.empty()) {
+            earliest = std::min(earliest, victim.inbox.front().staleAt);
+        }
+    }
+    return earliest;
+}
+
+// Returns false once the pool is shutting down and there is nothing left to run, or when
+// an elastic pool retires the worker after keepAlive without work.
+// One parked worker, the watcher, sleeps with a deadline: the next timer or the moment
+// the oldest task in a busy worker's inbox becomes stealable, whichever is earlier.
+bool ThreadPool::park(size_t index, uint64_t &idleSince) {
+    WorkerCounters &counter = counters[index];
+    Worker &worker = workers[index];
+    std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::WorkerPop);
+    while (!working && !hasQueuedTasks()) {
+        uint64_t parkedSince = statsNow();
+        // Lock-free producers push, fence and then skip the notify while parkedWorkers is 0.
+        // The seq_cst increment followed by a fresh look at every queue pairs with that
+        // fence: either the producer sees this worker parked, or the worker sees the task.
+        parkedWorkers.fetch_add(1, std::memory_order_seq_cst);
+        worker.parked = true;
+        std::chrono::steady_clock::time_point staleAt = nextStaleInboxTask(index);
+        if (hasQueuedTasks() || hasStealableJobs() || worker.inboxSize.load() > 0 ||
+            staleAt <= std::chrono::steady_clock::now()) {
+            worker.parked = false;
+            parkedWorkers--;
+            break;
+        }
+        if (!watcherParked && (timers.size() > 0 || staleAt != std::chrono::steady_clock::time_point::max())) {
+            watcherParked = true;
+            TimerWheel::Clock::time_point deadline = std::min(timers.nextDeadline(), staleAt);
+            watcherWakeTick = timers.toTick(deadline);
+            conditionVariable.wait_until(lock, deadline);
+            watcherWakeTick = UINT64_MAX;
+            watcherParked = false;
+            worker.parked = false;
+            parkedWorkers--;
+            lock.unlock();
+            serviceTimers();
+            lock.lock();
+        } else if (elastic) {
+            bool timedOut = conditionVariable.wait_for(lock, keepAlive) == std::cv_status::timeout;
+            worker.parked = false;
+            parkedWorkers--;
+            if (timedOut && !working && targetWorkers > minWorkers && !hasQueuedTasks() && !hasStealableJobs() &&
+                worker.inboxSize.load() == 0) {
+                targetWorkers--;
+                liveWorkers--;
+                worker.running = false;
+                return false;
+            }
+        } else {
+            conditionVariable.wait(lock);
+            worker.parked = false;
+            parkedWorkers--;
+        }
+        uint64_t wokenAt = statsNow();
+        WorkerCounters::add(counter.parkedNanoseconds, wokenAt - parkedSince);
+        WorkerCounters::add(counter.idleNanoseconds, parkedSince - idleSince);
+        WorkerCounters::add(counter.wakeups, 1);
+        if (!hasQueuedTasks() && !working && !hasStealableJobs() && worker.inboxSize.load() == 0) {
+            WorkerCounters::add(counter.spuriousWakeups, 1);
+        }
+        idleSince = wokenAt;
+    }
+    if (!working || hasQueuedTasks() || hasStealableJobs() || worker.inboxSize.load() > 0) {
+        return true;
+    }
+    drained.notify_all();
+    return false;
+}
+
+void ThreadPool::runTask(size_t index, Task &task, uint64_t &idleSince, Lane lane) {
+    WorkerCounters &counter = counters[index];
+    uint64_t startedAt = statsNow();
+    WorkerCounters::add(counter.idleNanoseconds, startedAt - idleSince);
+#ifdef THREADPOOL_STATS
+    WorkerCounters::add(counter.laneTasks[size_t(lane)], 1);
+    WorkerCounters::add(counter.laneWaitNanoseconds[size_t(lane)], startedAt - task.queuedAt);
+#else
+    (void) lane;
+#endif
+#ifdef THREADPOOL_TRACE
+    Trace::record(TraceEventType::TaskStart, task.flowId);
+    Trace::currentFlowId() = task.flowId;
+#endif
+#ifdef THREADPOOL_HISTOGRAMS
+    uint64_t startTicks = readTicks();
+    histograms[index].queueWait.record(startTicks - task.enqueuedAt);
+    task.function();
+    histograms[index].execution.record(readTicks() - startTicks);
+#else
+    task.function();
+#endif
+#ifdef THREADPOOL_TRACE
+    Trace::currentFlowId() = 0;
+    Trace::record(TraceEventType::TaskEnd, task.flowId);
+#endif
+    idleSince = statsNow();
+    WorkerCounters::add(counter.busyNanoseconds, idleSince - startedAt);
+    WorkerCounters::add(counter.tasksExecuted, 1);
+    if (timers.size() > 0) {
+        serviceTimers();
+    }
+}
+
+bool ThreadPool::beginBlocking() {
+    if (localBlocked) {
+        return false;
+    }
+    localBlocked = true;
+    std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+    blockedWorkers++;
+    if (!working && liveWorkers < targetWorkers + blockedWorkers) {
+        for (size_t i = 0; i < workerCount; i++) {
+            if (workers[i].spare) {
+                workers[i].spare = false;
+                spareWorkers--;
+                liveWorkers++;
+                spareWakeup.notify_all();
+                return true;
+            }
+        }
+        spawnWorkerLocked();
+    }
+    return true;
+}
+
+// The compensation worker is not stopped here: whichever worker next finds the pool over
+// its target, between tasks or before parking, turns into a spare.
+void ThreadPool::endBlocking() {
+    localBlocked = false;
+    blockedWorkers--;
+}
+
+bool ThreadPool::retireSurplus(size_t index) {
+    Worker &worker = workers[index];
+    std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+    if (!overTarget() || working || !worker.deque.empty() || worker.inboxSize.load() > 0) {
+        return true;
+    }
+    liveWorkers--;
+    worker.spare = true;
+    spareWorkers++;
+    bool activated = spareWakeup.wait_for(lock, keepAlive, [this, &worker]() {
+        return !worker.spare || working;
+    });
+    if (activated && !worker.spare) {
+        return true;
+    }
+    worker.spare = false;
+    spareWorkers--;
+    worker.running = false;
+    return false;
+}
+
+void ThreadPool::executeOn(size_t workerIndex, std::function<void()> const &function) {
+    if (workerIndex >= maxWorkers) {
+        throw std::out_of_range("ThreadPool::executeOn: no such worker");
+    }
+    pushInbox(workerIndex, function);
+}
+
+void ThreadPool::pushInbox(size_t workerIndex, std::function<void()> const &function) {
+    if (isShutdown()) {
+        throw RejectedExecutionError("ThreadPool is shut down");
+    }
+    Worker &worker = workers[workerIndex];
+    std::chrono::steady_clock::time_point staleAt = std::chrono::steady_clock::now() + affinityTimeout;
+    {
+        std::unique_lock<std::mutex> lock(worker.inboxMutex);
+        worker.inbox.push_back(InboxTask{makeTask(function), staleAt});
+        worker.inboxSize.store(worker.inbox.size(), std::memory_order_release);
+    }
+    // Pairs with the increment of parkedWorkers before a worker checks the inboxes.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parkedWorkers.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Execute);
+    if (worker.parked) {
+        // The condition variable is shared, so the target can only be reached by waking everyone.
+        conditionVariable.notify_all();
+    } else if (!watcherParked) {
+        // Some parked worker has to become the watcher that steals the task if it goes stale.
+        conditionVariable.notify_one();
+    } else if (timers.toTick(staleAt) < watcherWakeTick) {
+        conditionVariable.notify_all();
+    }
+}
+
+void ThreadPool::executeOnNode(int node, std::function<void()> const &function) {
+    size_t nodeIndex = std::find(nodeIds.begin(), nodeIds.end(), node) - nodeIds.begin();
+    if (nodeIndex == nodeCount) {
+        throw std::out_of_range("ThreadPool::executeOnNode: no such NUMA node");
+    }
+    if (isShutdown()) {
+        throw RejectedExecutionError("ThreadPool is shut down");
+    }
+    NodeQueue &nodeQueue = nodeQueues[nodeIndex];
+    {
+        std::unique_lock<std::mutex> lock(nodeQueue.mutex);
+        nodeQueue.tasks.push_back(makeTask(function));
+        nodeQueue.size.store(nodeQueue.tasks.size(), std::memory_order_release);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parkedWorkers.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Execute);
+    for (size_t i = 0; i < workerCount; i++) {
+        if (workers[i].parked && workers[i].node == nodeIndex) {
+            conditionVariable.notify_all();
+            return;
+        }
+    }
+    conditionVariable.notify_one();
+}
+
+void ThreadPool::executeLocal(std::function<void()> const &function) {
+    if (localThreadPoolPtr == this) {
+        pushInbox(localWorkerIndex, function);
+    } else {
+        execute(function);
+    }
+}
+
+int ThreadPool::currentWorkerIndex() const {
+    return localThreadPoolPtr == this ? int(localWorkerIndex) : -1;
+}
+
+void ThreadPool::runJob(ForkJoinJob *job, WorkerCounters &counter, bool stolen) {
+    uint64_t startedAt = statsNow();
+    job->execute();
+    WorkerCounters::add(counter.busyNanoseconds, statsNow() - startedAt);
+    WorkerCounters::add(counter.tasksExecuted, 1);
+    if (stolen) {
+        WorkerCounters::add(counter.tasksStolen, 1);
+    }
+}
+
+bool ThreadPool::pushLocal(ForkJoinJob *job) {
+    if (!workers[localWorkerIndex].deque.push(job)) {
+        return false;
+    }
+    // Pairs with the increment of parkedWorkers before a worker checks the deques.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parkedWorkers.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+        conditionVariable.notify_one();
+    }
+    return true;
+}
+
+// Tries the workers on the thief's own node before the remote ones.
+ForkJoinJob *ThreadPool::stealJob() {
+    bool onWorker = localThreadPoolPtr == this;
+    size_t self = onWorker ? localWorkerIndex : 0;
+    size_t passes = nodeCount > 1 ? 2 : 1;
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (size_t i = onWorker ? 1 : 0; i < workerCount; i++) {
+            size_t victim = (self + i) % workerCount;
+            if (passes > 1 && (workers[victim].node == workers[self].node) != (pass == 0)) {
+                continue;
+            }
+            if (ForkJoinJob *job = workers[victim].deque.steal()) {
+                return job;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool ThreadPool::hasStealableJobs() const {
+    for (size_t i = 0; i < workerCount; i++) {
+        if (!workers[i].deque.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::executeBounded(Task &&task) {
+    if (boundedQueue->tryPush(std::move(task))) {
+        notifyBoundedPush();
+        return;
+    }
+    OverflowPolicy policy = overflowPolicy;
+    if (policy == OverflowPolicy::Block && localThreadPoolPtr == this) {
+        policy = OverflowPolicy::CallerRuns;
+    }
+    switch (policy) {
+        case OverflowPolicy::Block: {
+            std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Execute);
+            blockedProducers++;
+            // Pairs with the fence after a worker pops, so that either the retry sees the
+            // freed cell or the worker sees blockedProducers and notifies.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!boundedQueue->tryPush(std::move(task))) {
+                if (isShutdown()) {
+                    blockedProducers--;
+                    throw RejectedExecutionError("ThreadPool is shut down");
                 }
-                task();
+                spaceAvailable.wait(lock);
             }
-        });
+            blockedProducers--;
+            lock.unlock();
+            notifyBoundedPush();
+            return;
+        }
+        case OverflowPolicy::Reject:
+            rejectedTasks++;
+            throw RejectedExecutionError();
+        case OverflowPolicy::CallerRuns:
+            callerRunTasks++;
+            task.function();
+            return;
+        case OverflowPolicy::DropOldest:
+            while (!boundedQueue->tryPush(std::move(task))) {
+                Task dropped;
+                if (boundedQueue->tryPop(dropped)) {
+                    droppedTasks++;
+                }
+            }
+            notifyBoundedPush();
+            return;
     }
 }
 
-ThreadPool::~ThreadPool() {
+void ThreadPool::notifyBoundedPush() {
+    size_t depth = boundedQueue->size();
+    if (depth > queueHighWaterMark.load(std::memory_order_relaxed)) {
+        queueHighWaterMark.store(depth, std::memory_order_relaxed);
+    }
+    // Pairs with the increment of parkedWorkers before a worker checks the queue.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parkedWorkers.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Execute);
+        conditionVariable.notify_one();
+    }
+}
+
+TimerHandle ThreadPool::scheduleTimer(std::chrono::steady_clock::time_point deadline,
+                                      std::chrono::steady_clock::duration period,
+                                      std::function<void()> const &task) {
+    if (isShutdown()) {
+        throw RejectedExecutionError("ThreadPool is shut down");
+    }
+    TimerHandle handle = timers.schedule(deadline, period, task);
+    // A parked worker has to re-arm its sleep if this timer is due before it wakes up.
+    if (parkedWorkers > 0 && timers.toTick(deadline) < watcherWakeTick) {
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+        conditionVariable.notify_all();
+    }
+    return handle;
+}
+
+void ThreadPool::serviceTimers() {
+    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+    if (!timers.due(now)) {
+        return;
+    }
+    for (auto &callback: timers.advance(now)) {
+        // Timer firings are not lost to a full queue; a rejected one runs here instead,
+        // unless the rejection is because the pool is shutting down.
+        try {
+            execute(callback);
+        } catch (RejectedExecutionError &) {
+            if (!working) {
+                callback();
+            }
+        }
+    }
+}
+
+ThreadPoolStats ThreadPool::stats() const {
+    ThreadPoolStats result;
+    for (size_t i = 0; i < workerCount; i++) {
+        WorkerStats worker = counters[i].snapshot();
+        if (i < maxWorkers) {
+            result.workers.push_back(worker);
+        } else {
+            result.compensation += worker;
+        }
+        result.total += worker;
+    }
+    result.activeWorkers = liveWorkers.load(std::memory_order_relaxed);
+    result.blockedWorkers = blockedWorkers.load(std::memory_order_relaxed);
+    result.queueDepth = pendingTasks();
+    for (size_t i = 0; i < size_t(Lane::Count); i++) {
+        result.lanes[i].queueDepth = scheduledLaneDepth[i].load(std::memory_order_relaxed);
+        result.lanes[i].tasksExecuted = result.total.laneTasks[i];
+        result.lanes[i].waitNanoseconds = result.total.laneWaitNanoseconds[i];
+    }
+    size_t scheduledDepth = 0;
+    for (size_t i = 0; i < size_t(Lane::Count); i++) {
+        scheduledDepth += result.lanes[i].queueDepth;
+    }
+    result.lanes[size_t(Lane::Normal)].queueDepth = result.queueDepth - std::min(result.queueDepth, scheduledDepth);
+    result.queueHighWaterMark = queueHighWaterMark.load(std::memory_order_relaxed);
+    result.queueCapacity = boundedQueue ? boundedQueue->capacity() : 0;
+    result.rejectedTasks = rejectedTasks.load(std::memory_order_relaxed);
+    result.droppedTasks = droppedTasks.load(std::memory_order_relaxed);
+    result.callerRunTasks = callerRunTasks.load(std::memory_order_relaxed);
+    return result;
+}
+
+HistogramSnapshot ThreadPool::queueWaitHistogram() const {
+    HistogramSnapshot result;
+    for (size_t i = 0; histograms && i < workerCount; i++) {
+        result.merge(histograms[i].queueWait.snapshot());
+    }
+    return result;
+}
+
+HistogramSnapshot ThreadPool::executionHistogram() const {
+    HistogramSnapshot result;
+    for (size_t i = 0; histograms && i < workerCount; i++) {
+        result.merge(histograms[i].execution.snapshot());
+    }
+    return result;
+}
+
+std::vector<std::function<void()>> ThreadPool::shutdown(ShutdownMode mode,
+                                                        std::chrono::steady_clock::duration timeout) {
+    if (localThreadPoolPtr == this) {
+        throw std::logic_error("ThreadPool cannot be shut down from its own worker");
+    }
+    std::unique_lock<std::mutex> shutdownLock(shutdownMutex);
+    std::vector<std::function<void()>> unrun;
     {
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+        shutdownStarted = true;
         working = true;
-        std::unique_lock<std::mutex> lock(mutex);
+        conditionVariable.notify_all();
+        supervisorWakeup.notify_all();
+        spareWakeup.notify_all();
+        spaceAvailable.notify_all();
+        timers.clear();
+        if (mode == ShutdownMode::DrainWithTimeout && !drained.wait_for(lock, timeout, [this]() {
+            return !hasPendingWork();
+        })) {
+            lock.unlock();
+            takeQueuedTasks(unrun);
+        }
     }
-    conditionVariable.notify_all();
+    joinWorkers();
+    // Tasks that raced with the shutdown flag into a queue no worker was left to check.
+    takeQueuedTasks(unrun);
+    return unrun;
+}
+
+std::vector<std::function<void()>> ThreadPool::shutdownNow() {
+    return shutdown(ShutdownMode::DrainWithTimeout, std::chrono::steady_clock::duration::zero());
+}
 
+bool ThreadPool::hasPendingWork() const {
+    if (hasQueuedTasks() || hasStealableJobs()) {
+        return true;
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        if (workers[i].inboxSize.load(std::memory_order_acquire) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::takeQueuedTasks(std::vector<std::function<void()>> &tasks) {
+    if (boundedQueue) {
+        Task task;
+        while (boundedQueue->tryPop(task)) {
+            tasks.push_back(std::move(task.function));
+        }
+    } else {
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Other);
+        while (!queue.empty()) {
+            tasks.push_back(std::move(queue.front().function));
+            queue.pop();
+        }
+        queueDepth.store(0, std::memory_order_relaxed);
+    }
+    {
+        std::unique_lock<std::mutex> lock(scheduledMutex);
+        for (auto &scheduledTask: scheduled) {
+            tasks.push_back(std::move(scheduledTask.task.function));
+        }
+        scheduled.clear();
+        for (auto &depth: scheduledLaneDepth) {
+            depth.store(0, std::memory_order_relaxed);
+        }
+        scheduledSize.store(0, std::memory_order_release);
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        std::unique_lock<std::mutex> lock(nodeQueues[i].mutex);
+        for (auto &task: nodeQueues[i].tasks) {
+            tasks.push_back(std::move(task.function));
+        }
+        nodeQueues[i].tasks.clear();
+        nodeQueues[i].size.store(0, std::memory_order_release);
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        std::unique_lock<std::mutex> lock(workers[i].inboxMutex);
+        for (auto &inboxTask: workers[i].inbox) {
+            tasks.push_back(std::move(inboxTask.task.function));
+        }
+        workers[i].inbox.clear();
+        workers[i].inboxSize.store(0, std::memory_order_release);
+    }
+}
+
+void ThreadPool::joinWorkers() {
+    if (supervisor.joinable()) {
+        supervisor.join();
+    }
     for (auto &thread: threads) {
-        thread.join();
+        if (thread.joinable()) {
+            thread.join();
+        }
     }
 }
 
-thread_local ThreadPool *ThreadPool::localThreadPoolPtr = nullptr;
\ No newline at end of file
+ThreadPool::~ThreadPool() {
+    std::unique_lock<std::mutex> shutdownLock(shutdownMutex);
+    {
+        working = true;
+        std::unique_lock<InstrumentedMutex> lock(mutex);
+    }
+    conditionVariable.notify_all();
+    supervisorWakeup.notify_all();
+    spareWakeup.notify_all();
+    joinWorkers();
+}
+
+std::shared_ptr<LimitedExecutor> ThreadPool::limited(size_t maxConcurrent) {
+    return std::shared_ptr<LimitedExecutor>(new LimitedExecutor(*this, maxConcurrent));
+}
+
+thread_local ThreadPool *ThreadPool::localThreadPoolPtr = nullptr;
+
+thread_local size_t ThreadPool::localWorkerIndex = 0;
+
+thread_local bool ThreadPool::localBlocked = false;
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <functional>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <memory>
 #include <future>
 #include <thread>
@@ -10,25 +11,502 @@
 #include <condition_variable>
 #include <atomic>
 #include <iostream>
+#include <stdexcept>
+#include "Aligned.h"
+#include "Stats.h"
+#include "Histogram.h"
+#include "Trace.h"
+#include "LockProfiler.h"
+#include "TimerWheel.h"
+#include "WorkStealingDeque.h"
+#include "BoundedQueue.h"
+#include "Topology.h"
+#include "Executor.h"
 
-class ThreadPool {
+template<typename F>
+class ForkJoinTask;
+
+class LimitedExecutor;
+
+// What execute() does when a bounded queue is full. Block and CallerRuns run the task
+// inline when called from one of the pool's own workers, which could otherwise deadlock.
+enum class OverflowPolicy {
+    Block,
+    Reject,
+    CallerRuns,
+    DropOldest
+};
+
+class RejectedExecutionError : public std::runtime_error {
+public:
+    RejectedExecutionError() : std::runtime_error("ThreadPool queue is full") {
+    }
+
+    explicit RejectedExecutionError(const char *what) : std::runtime_error(what) {
+    }
+};
+
+// How ThreadPool::shutdown() treats the tasks still queued: Drain runs all of them,
+// DrainWithTimeout runs them until the timeout and then drops the rest like shutdownNow().
+enum class ShutdownMode {
+    Drain,
+    DrainWithTimeout
+};
+
+// Where workers run. CpuSet pins every worker to ThreadPoolOptions::cpuSet, PerCore pins
+// worker i to the i-th physical core, PerNode pins worker i to all CPUs of NUMA node
+// i mod nodes. Pinning failures (e.g. CPUs outside the process cpuset) are ignored.
+enum class WorkerPlacement {
+    None,
+    CpuSet,
+    PerCore,
+    PerNode
+};
+
+enum class Priority {
+    High,
+    Normal,
+    Low
+};
+
+struct ThreadPoolOptions {
+    // 0 keeps the queue unbounded.
+    size_t queueCapacity = 0;
+    OverflowPolicy overflowPolicy = OverflowPolicy::Block;
+    // How long a task sent to a busy worker with executeOn() waits before other workers
+    // may steal it.
+    std::chrono::steady_clock::duration affinityTimeout = std::chrono::milliseconds(1);
+    WorkerPlacement placement = WorkerPlacement::None;
+    std::vector<int> cpuSet;
+    // Topology::system() when null.
+    const Topology *topology = nullptr;
+    // A non-zero maxWorkers makes the pool elastic: it starts with num_threads workers,
+    // a supervisor thread adds one whenever at least growQueueDepth tasks have been
+    // queued for growAfter with no worker idle, and workers idle for keepAlive retire
+    // down to minWorkers (at least 1).
+    size_t minWorkers = 1;
+    size_t maxWorkers = 0;
+    size_t growQueueDepth = 16;
+    std::chrono::steady_clock::duration growAfter = std::chrono::milliseconds(10);
+    std::chrono::steady_clock::duration keepAlive = std::chrono::seconds(30);
+    // Extra worker slots for compensation workers, which keep the pool's parallelism up while
+    // workers block inside a BlockingScope, e.g. in Future::get() on a future that is still
+    // not ready after a short grace period. Each compensation starts a thread, and every slot,
+    // used or not, costs a deque and lengthens the scans in park() and stealing. The default
+    // gives one slot per worker, at most 8; 0 turns compensation off.
+    static constexpr size_t oneSlotPerWorker = size_t(-1);
+    size_t maxCompensationWorkers = oneSlotPerWorker;
+    // Low priority tasks rank like High ones submitted this much later, and the Normal
+    // lane is served at least once per agingThreshold while the other lanes have work.
+    std::chrono::steady_clock::duration agingThreshold = std::chrono::milliseconds(50);
+};
+
+class ThreadPool final : public Executor {
 public :
     ThreadPool(size_t num_threads);
 
+    ThreadPool(size_t num_threads, ThreadPoolOptions const &options);
+
     static thread_local ThreadPool *localThreadPoolPtr;
 
-    void execute(std::function<void()> const &task) {
-        std::unique_lock<std::mutex> lock(mutex);
-        queue.push(task);
+    // Throws RejectedExecutionError once the pool is shut down.
+    void execute(std::function<void()> const &function) override {
+        if (isShutdown()) {
+            throw RejectedExecutionError("ThreadPool is shut down");
+        }
+        Task task = makeTask(function);
+        if (boundedQueue) {
+            executeBounded(std::move(task));
+            return;
+        }
+        std::unique_lock<InstrumentedMutex> lock = lockAt(mutex, LockSite::Execute);
+        // Checked again under the mutex that shutdown takes, so nothing slips into the queue
+        // after shutdownNow() has emptied it.
+        if (isShutdown()) {
+            throw RejectedExecutionError("ThreadPool is shut down");
+        }
+        queue.push(std::move(task));
+        size_t depth = queue.size();
+        queueDepth.store(depth, std::memory_order_relaxed);
+        if (depth > queueHighWaterMark.load(std::memory_order_relaxed)) {
+            queueHighWaterMark.store(depth, std::memory_order_relaxed);
+        }
         conditionVariable.notify_one();
     }
 
+    // High and Low priority tasks, and tasks with a deadline, share one earliest-deadline-first
+    // queue that workers check before the Normal lane (execute()). A High task ranks by its
+    // submission time, a Low one agingThreshold after it, so old Low tasks overtake new High
+    // ones. These lanes bypass the capacity of a bounded queue.
+    void execute(Priority priority, std::function<void()> const &function);
+
+    void executeBy(std::chrono::steady_clock::time_point deadline, std::function<void()> const &function);
+
+    // Queues the task on one worker, so that consecutive tasks for the same data share a
+    // cache. The affinity is soft: once the task has waited affinityTimeout, idle workers
+    // may steal it. Bypasses the capacity of a bounded queue.
+    void executeOn(size_t workerIndex, std::function<void()> const &function);
+
+    // Queues the task for the workers on the given NUMA node, which take it before the
+    // shared queue; workers on other nodes only get to it once they run out of work.
+    void executeOnNode(int node, std::function<void()> const &function);
+
+    // NUMA node id the worker was placed on; always the first node without placement.
+    int workerNode(size_t workerIndex) const {
+        return nodeIds[workers[workerIndex].node];
+    }
+
+    // executeOn() the calling worker, or execute() when not called from this pool.
+    void executeLocal(std::function<void()> const &function);
+
+    // Index of the calling worker's slot, or -1 if it is not one of this pool's workers.
+    // Compensation workers (see BlockingScope) take the first free slot, which is past
+    // size() in a fixed-size pool but may be below it in an elastic one.
+    int currentWorkerIndex() const;
+
+    // Number of worker slots, i.e. maxWorkers for an elastic pool; see activeWorkers() for
+    // how many of them currently run a thread. Compensation workers may also use the extra
+    // slots past size().
+    size_t size() const {
+        return maxWorkers;
+    }
+
+    // Slots including those kept for compensation workers; currentWorkerIndex() is always
+    // below this.
+    size_t workerSlots() const {
+        return workerCount;
+    }
+
+    size_t activeWorkers() const {
+        return liveWorkers.load(std::memory_order_relaxed);
+    }
+
+    // Executor that runs at most maxConcurrent of its tasks on this pool at a time and
+    // queues the rest itself; see LimitedExecutor.
+    std::shared_ptr<LimitedExecutor> limited(size_t maxConcurrent);
+
+    // Runs the function as a BlockingScope: while it blocks, a compensation worker keeps the
+    // pool's parallelism up. Outside of pool workers it just calls the function.
+    template<typename F>
+    static auto blocking(F &&function) -> decltype(function());
+
+    // Timers are kept in a TimerWheel serviced by the workers themselves: one parked
+    // worker sleeps until the next deadline and busy workers check between tasks, so an
+    // expired callback is enqueued like a regular task. With every worker stuck in a long
+    // task, timers fire late.
+    template<typename Rep, typename Period>
+    TimerHandle executeAfter(std::chrono::duration<Rep, Period> delay, std::function<void()> const &task) {
+        return scheduleTimer(std::chrono::steady_clock::now() + delay, std::chrono::steady_clock::duration::zero(),
+                             task);
+    }
+
+    TimerHandle executeAt(std::chrono::steady_clock::time_point time, std::function<void()> const &task) {
+        return scheduleTimer(time, std::chrono::steady_clock::duration::zero(), task);
+    }
+
+    // Runs the task every period starting one period from now, until the handle is
+    // cancelled. Runs may overlap if a run takes longer than the period.
+    template<typename Rep, typename Period>
+    TimerHandle executeEvery(std::chrono::duration<Rep, Period> period, std::function<void()> const &task) {
+        auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+        return scheduleTimer(std::chrono::steady_clock::now() + interval, interval, task);
+    }
+
+    // Aggregates the worker counters without stopping the workers, so the snapshot
+    // is not atomic across counters. Worker counters stay zero unless THREADPOOL_STATS
+    // is defined; queue depth, its high-water mark and the overflow counters are always
+    // maintained.
+    ThreadPoolStats stats() const;
+
+    // Time from execute() to the task starting, and the task's own run time, merged
+    // over all workers. Empty unless THREADPOOL_HISTOGRAMS is defined.
+    HistogramSnapshot queueWaitHistogram() const;
+
+    HistogramSnapshot executionHistogram() const;
+
+    // Stops taking tasks: from now on every way of submitting one throws
+    // RejectedExecutionError, also for tasks the running ones submit. Waits for the queued
+    // tasks according to mode, then for the workers to finish, and returns the tasks that
+    // were not run. Running tasks are never interrupted, so with DrainWithTimeout the call
+    // can outlast the timeout by the longest of them. Pending timers do not fire any more.
+    // Must not be called from one of the pool's workers.
+    std::vector<std::function<void()>> shutdown(ShutdownMode mode = ShutdownMode::Drain,
+                                                std::chrono::steady_clock::duration timeout =
+                                                std::chrono::steady_clock::duration::zero());
+
+    // Like shutdown(), but takes the queued tasks out without running them. Destroying the
+    // returned tasks destroys the promises they would have completed, so callers blocked
+    // in Future::get() on them fail at once instead of waiting.
+    std::vector<std::function<void()>> shutdownNow();
+
+    bool isShutdown() const {
+        return shutdownStarted.load(std::memory_order_relaxed);
+    }
+
+    // Drains the queue like shutdown(Drain), except that tasks may still be submitted
+    // until the queue is empty.
     ~ThreadPool();
 
 private:
-    std::queue<std::function<void()> > queue;
+    friend class BlockingScope;
+    struct Task {
+        std::function<void()> function;
+#ifdef THREADPOOL_HISTOGRAMS
+        uint64_t enqueuedAt;
+#endif
+#ifdef THREADPOOL_TRACE
+        uint64_t flowId;
+#endif
+#ifdef THREADPOOL_STATS
+        uint64_t queuedAt;
+#endif
+    };
+
+    struct ScheduledTask {
+        Task task;
+        // Steady clock nanoseconds: the deadline, or the submission time for Priority lanes
+        // plus the aging offset.
+        uint64_t rank;
+        uint64_t sequence;
+        Lane lane;
+
+        // Inverted for std::push_heap, which keeps the largest element first.
+        bool operator<(const ScheduledTask &other) const {
+            return rank != other.rank ? rank > other.rank : sequence > other.sequence;
+        }
+    };
+
+    struct InboxTask {
+        Task task;
+        std::chrono::steady_clock::time_point staleAt;
+    };
+
+    struct Worker {
+        WorkStealingDeque deque;
+        std::mutex inboxMutex;
+        std::deque<InboxTask> inbox;
+        std::atomic<size_t> inboxSize{0};
+        // Guarded by the pool mutex.
+        bool parked = false;
+        bool running = false;
+        // A surplus compensation worker waiting on spareWakeup to be reactivated.
+        bool spare = false;
+        // Index into nodeQueues, and the CPUs the worker pins itself to.
+        size_t node = 0;
+        std::vector<int> cpus;
+    };
+
+    struct NodeQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<size_t> size{0};
+    };
+
+    struct WorkerHistograms {
+        LatencyHistogram queueWait;
+        LatencyHistogram execution;
+    };
+
+    template<typename F>
+    friend class ForkJoinTask;
+
+    static Task makeTask(std::function<void()> const &function) {
+        Task task;
+        task.function = function;
+#ifdef THREADPOOL_HISTOGRAMS
+        task.enqueuedAt = readTicks();
+#endif
+#ifdef THREADPOOL_TRACE
+        task.flowId = Trace::enqueueTask();
+#endif
+#ifdef THREADPOOL_STATS
+        task.queuedAt = statsNow();
+#endif
+        return task;
+    }
+
+    void workerLoop(size_t index);
+
+    bool popQueue(Task &task);
+
+    // executeOn() without the range check, so a compensation worker can target its own slot.
+    void pushInbox(size_t workerIndex, std::function<void()> const &function);
+
+    bool popInbox(size_t index, Task &task);
+
+    bool stealInbox(size_t index, Task &task);
+
+    std::chrono::steady_clock::time_point nextStaleInboxTask(size_t index);
+
+    bool park(size_t index, uint64_t &idleSince);
+
+    void runTask(size_t index, Task &task, uint64_t &idleSince, Lane lane = Lane::Normal);
+
+    void schedule(Task &&task, uint64_t rank, Lane lane);
+
+    bool popScheduled(Task &task, Lane &lane);
+
+    static uint64_t steadyNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Bounded queues take producers through a lock-free ring and only lock the pool
+    // mutex to wake a parked worker or to block on a full queue.
+    void executeBounded(Task &&task);
+
+    void notifyBoundedPush();
+
+    bool hasQueuedTasks() const {
+        if (scheduledSize.load(std::memory_order_acquire) > 0) {
+            return true;
+        }
+        for (size_t i = 0; i < nodeCount; i++) {
+            if (nodeQueues[i].size.load(std::memory_order_acquire) > 0) {
+                return true;
+            }
+        }
+        return boundedQueue ? !boundedQueue->empty() : !queue.empty();
+    }
+
+    void placeWorkers(ThreadPoolOptions const &options);
+
+    // Starts a thread in a free slot; needs the pool mutex. Returns false if all slots are taken.
+    bool spawnWorkerLocked();
+
+    // Blocked workers do not count towards the target: live = target + blocked. Returns
+    // false if the calling worker is already blocked.
+    bool beginBlocking();
+
+    void endBlocking();
+
+    bool overTarget() const {
+        return liveWorkers.load(std::memory_order_relaxed) >
+               targetWorkers.load(std::memory_order_relaxed) + blockedWorkers.load(std::memory_order_relaxed);
+    }
+
+    // Parks a worker the pool no longer needs as a spare; returns false if it has to exit.
+    bool retireSurplus(size_t index);
+
+    void supervisorLoop(std::chrono::steady_clock::duration growAfter, size_t growQueueDepth);
+
+    size_t pendingTasks() const;
+
+    bool popNodeQueue(size_t node, Task &task);
+
+    bool stealNodeQueue(size_t index, Task &task);
+
+    // Fork-join support; pushLocal() and popLocal() must run on one of this pool's workers.
+    bool pushLocal(ForkJoinJob *job);
+
+    ForkJoinJob *popLocal() {
+        return workers[localWorkerIndex].deque.pop();
+    }
+
+    ForkJoinJob *stealJob();
+
+    bool hasStealableJobs() const;
+
+    void runJob(ForkJoinJob *job, WorkerCounters &counter, bool stolen);
+
+    TimerHandle scheduleTimer(std::chrono::steady_clock::time_point deadline,
+                              std::chrono::steady_clock::duration period, std::function<void()> const &task);
+
+    void serviceTimers();
+
+    // Needs the pool mutex.
+    bool hasPendingWork() const;
+
+    // Moves every task that is queued anywhere but in a fork-join deque into tasks.
+    void takeQueuedTasks(std::vector<std::function<void()>> &tasks);
+
+    void joinWorkers();
+
+    std::queue<Task> queue;
+    AlignedPtr<BoundedQueue<Task>> boundedQueue;
+    OverflowPolicy overflowPolicy;
+    std::atomic<size_t> blockedProducers;
+    InstrumentedConditionVariable spaceAvailable;
+    std::atomic<uint64_t> rejectedTasks;
+    std::atomic<uint64_t> droppedTasks;
+    std::atomic<uint64_t> callerRunTasks;
+    std::chrono::steady_clock::duration affinityTimeout;
+    // One per worker slot; the thread of a retired worker stays here until it is joined.
     std::vector<std::thread> threads;
+    AlignedArray<Worker> workers;
+    size_t workerCount;
+    std::unique_ptr<NodeQueue[]> nodeQueues;
+    size_t nodeCount;
+    std::vector<int> nodeIds;
+    std::mutex scheduledMutex;
+    // Binary heap ordered by ScheduledTask::operator<.
+    std::vector<ScheduledTask> scheduled;
+    std::atomic<size_t> scheduledSize;
+    std::atomic<size_t> scheduledLaneDepth[size_t(Lane::Count)];
+    uint64_t scheduledSequence;
+    uint64_t agingNanoseconds;
+    // When a worker first passed over a non-empty Normal lane for the scheduled tasks; 0
+    // while the Normal lane is being served.
+    std::atomic<uint64_t> normalPassedOverSince;
+    static thread_local size_t localWorkerIndex;
+    AlignedArray<WorkerCounters> counters;
+    std::unique_ptr<WorkerHistograms[]> histograms;
+    std::atomic<size_t> queueDepth;
+    std::atomic<size_t> queueHighWaterMark;
     std::atomic<bool> working;
-    std::mutex mutex;
-    std::condition_variable conditionVariable;
-};
\ No newline at end of file
+    std::atomic<bool> shutdownStarted;
+    // Serializes shutdown() and shutdownNow() with each other and the destructor.
+    std::mutex shutdownMutex;
+    InstrumentedMutex mutex;
+    InstrumentedConditionVariable conditionVariable;
+    // Notified by workers as they exit; shutdown(DrainWithTimeout) waits on it.
+    InstrumentedConditionVariable drained;
+    TimerWheel timers;
+    std::atomic<size_t> parkedWorkers;
+    std::atomic<size_t> liveWorkers;
+    std::atomic<size_t> targetWorkers;
+    std::atomic<size_t> blockedWorkers;
+    size_t spareWorkers;
+    InstrumentedConditionVariable spareWakeup;
+    static thread_local bool localBlocked;
+    size_t minWorkers;
+    size_t maxWorkers;
+    bool elastic;
+    std::chrono::steady_clock::duration keepAlive;
+    std::thread supervisor;
+    InstrumentedConditionVariable supervisorWakeup;
+    // Tick the watcher (see park()) sleeps until, UINT64_MAX if there is none.
+    std::atomic<uint64_t> watcherWakeTick;
+    bool watcherParked;
+};
+
+// Marks the calling pool worker as blocked for the lifetime of the scope, so that the pool
+// can run a compensation worker in its place. Does nothing outside pool workers or when the
+// worker is already inside a scope.
+class BlockingScope {
+public:
+    BlockingScope() : pool(ThreadPool::localThreadPoolPtr) {
+        if (pool && !pool->beginBlocking()) {
+            pool = nullptr;
+        }
+    }
+
+    ~BlockingScope() {
+        if (pool) {
+            pool->endBlocking();
+        }
+    }
+
+    BlockingScope(const BlockingScope &) = delete;
+
+    BlockingScope &operator=(const BlockingScope &) = delete;
+
+private:
+    ThreadPool *pool;
+};
+
+template<typename F>
+auto ThreadPool::blocking(F &&function) -> decltype(function()) {
+    BlockingScope scope;
+    return function();
+}
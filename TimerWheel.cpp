@@ -0,0 +1,184 @@
+#include "TimerWheel.h"
+
+bool TimerHandle::cancel() {
+    if (!node) {
+        return false;
+    }
+    std::shared_ptr<std::mutex> wheelMutex = node->wheelMutex;
+    std::unique_lock<std::mutex> lock(*wheelMutex);
+    TimerWheel *wheel = node->wheel;
+    if (!wheel) {
+        return false;
+    }
+    wheel->unlinkLocked(node.get());
+    wheel->pendingCount.fetch_sub(1, std::memory_order_release);
+    // Dropping the self reference last: the handle still holds the node.
+    node->self.reset();
+    return true;
+}
+
+bool TimerHandle::isActive() const {
+    if (!node) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(*node->wheelMutex);
+    return node->wheel != nullptr;
+}
+
+TimerWheel::TimerWheel() : origin(Clock::now()), mutex(std::make_shared<std::mutex>()), currentTick(0),
+                           pendingCount(0), nextCheckTick(0), slots(levels * slotsPerLevel) {
+}
+
+TimerWheel::~TimerWheel() {
+    std::unique_lock<std::mutex> lock(*mutex);
+    clearLocked();
+}
+
+void TimerWheel::clear() {
+    std::unique_lock<std::mutex> lock(*mutex);
+    clearLocked();
+}
+
+void TimerWheel::clearLocked() {
+    for (auto &slot: slots) {
+        while (slot.next != &slot) {
+            TimerNode *node = static_cast<TimerNode *>(slot.next);
+            unlinkLocked(node);
+            node->self.reset();
+        }
+    }
+    pendingCount.store(0, std::memory_order_release);
+}
+
+TimerHandle TimerWheel::schedule(Clock::time_point deadline, Clock::duration period,
+                                 std::function<void()> const &callback) {
+    std::shared_ptr<TimerNode> node = std::make_shared<TimerNode>();
+    node->callback = callback;
+    if (period > Clock::duration::zero()) {
+        node->period = std::max<uint64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(period).count());
+    }
+    node->wheelMutex = mutex;
+    node->self = node;
+    // Round up so that a timer never fires before its deadline.
+    uint64_t tick = toTick(deadline);
+    if (fromTick(tick) < deadline) {
+        tick++;
+    }
+    node->expiresAt = tick;
+
+    std::unique_lock<std::mutex> lock(*mutex);
+    insertLocked(node.get());
+    if (pendingCount.fetch_add(1) == 0 || node->expiresAt < nextCheckTick.load(std::memory_order_relaxed)) {
+        nextCheckTick.store(node->expiresAt, std::memory_order_relaxed);
+    }
+    return TimerHandle(node);
+}
+
+void TimerWheel::insertLocked(TimerNode *node) {
+    if (node->expiresAt <= currentTick) {
+        node->expiresAt = currentTick + 1;
+    }
+    uint64_t delta = node->expiresAt - currentTick;
+    size_t level = 0;
+    while (level + 1 < levels && delta >= (uint64_t(1) << (levelBits * (level + 1)))) {
+        level++;
+    }
+    uint64_t maxTick = currentTick + (uint64_t(1) << (levelBits * levels)) - 1;
+    if (node->expiresAt > maxTick) {
+        node->expiresAt = maxTick;
+    }
+    size_t index = size_t(node->expiresAt >> (levelBits * level)) & (slotsPerLevel - 1);
+    TimerLink &slot = slots[level * slotsPerLevel + index];
+    node->prev = slot.prev;
+    node->next = &slot;
+    slot.prev->next = node;
+    slot.prev = node;
+    node->wheel = this;
+}
+
+void TimerWheel::unlinkLocked(TimerNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node;
+    node->next = node;
+    node->wheel = nullptr;
+}
+
+void TimerWheel::cascadeLocked(size_t level) {
+    size_t index = size_t(currentTick >> (levelBits * level)) & (slotsPerLevel - 1);
+    TimerLink &slot = slots[level * slotsPerLevel + index];
+    TimerLink pending;
+    if (slot.next != &slot) {
+        pending.next = slot.next;
+        pending.prev = slot.prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        slot.next = slot.prev = &slot;
+    }
+    while (pending.next != &pending) {
+        TimerNode *node = static_cast<TimerNode *>(pending.next);
+        unlinkLocked(node);
+        insertLocked(node);
+    }
+}
+
+std::vector<std::function<void()>> TimerWheel::advance(Clock::time_point now) {
+    std::vector<std::function<void()>> expired;
+    std::unique_lock<std::mutex> lock(*mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return expired;
+    }
+    uint64_t target = toTick(now);
+    if (pendingCount.load(std::memory_order_relaxed) == 0) {
+        currentTick = std::max(currentTick, target);
+    }
+    while (currentTick < target) {
+        currentTick++;
+        for (size_t level = 1; level < levels; level++) {
+            if ((currentTick & ((uint64_t(1) << (levelBits * level)) - 1)) != 0) {
+                break;
+            }
+            cascadeLocked(level);
+        }
+        TimerLink &slot = slots[currentTick & (slotsPerLevel - 1)];
+        while (slot.next != &slot) {
+            TimerNode *node = static_cast<TimerNode *>(slot.next);
+            unlinkLocked(node);
+            expired.push_back(node->callback);
+            if (node->period) {
+                node->expiresAt = currentTick + node->period;
+                insertLocked(node);
+            } else {
+                pendingCount.fetch_sub(1, std::memory_order_release);
+                node->self.reset();
+            }
+        }
+        if (pendingCount.load(std::memory_order_relaxed) == 0) {
+            currentTick = target;
+        }
+    }
+    nextCheckTick.store(nextExpiryTickLocked(), std::memory_order_relaxed);
+    return expired;
+}
+
+uint64_t TimerWheel::nextExpiryTickLocked() const {
+    for (uint64_t tick = currentTick + 1; tick <= currentTick + slotsPerLevel; tick++) {
+        const TimerLink &slot = slots[tick & (slotsPerLevel - 1)];
+        if (slot.next != &slot) {
+            return tick;
+        }
+        if ((tick & (slotsPerLevel - 1)) == 0) {
+            // Higher levels cascade here and may bring timers due at this tick.
+            return tick;
+        }
+    }
+    return currentTick + slotsPerLevel;
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextDeadline() {
+    if (size() == 0) {
+        return Clock::time_point::max();
+    }
+    std::unique_lock<std::mutex> lock(*mutex);
+    return fromTick(nextExpiryTickLocked());
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class TimerWheel;
+
+struct TimerLink {
+    TimerLink *prev = this;
+    TimerLink *next = this;
+};
+
+struct TimerNode : TimerLink {
+    std::function<void()> callback;
+    uint64_t expiresAt = 0;
+    uint64_t period = 0;
+    // Keeps the node alive while it is linked into the wheel.
+    std::shared_ptr<TimerNode> self;
+    // Shared with the wheel so that a handle can still lock it after the wheel is gone;
+    // wheel is reset to nullptr under this mutex when the timer leaves the wheel.
+    std::shared_ptr<std::mutex> wheelMutex;
+    TimerWheel *wheel = nullptr;
+};
+
+class TimerHandle {
+public:
+    TimerHandle() = default;
+
+    // Returns true if the timer was still pending; a periodic timer stops firing.
+    // A callback that has already been handed to the pool still runs.
+    bool cancel();
+
+    bool isActive() const;
+
+private:
+    explicit TimerHandle(std::shared_ptr<TimerNode> node) : node(std::move(node)) {
+    }
+
+    friend class TimerWheel;
+
+    std::shared_ptr<TimerNode> node;
+};
+
+// Hierarchical timer wheel with 1ms ticks: 4 levels of 256 slots cover ~49 days, later
+// deadlines are clamped. Insert and cancel are O(1); advancing cascades a higher-level
+// slot into the lower levels whenever the lower level wraps around.
+class TimerWheel {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum : size_t {
+        levelBits = 8,
+        slotsPerLevel = 1 << levelBits,
+        levels = 4
+    };
+
+    TimerWheel();
+
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel &) = delete;
+
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    TimerHandle schedule(Clock::time_point deadline, Clock::duration period, std::function<void()> const &callback);
+
+    // Moves the wheel up to now and returns the callbacks of the timers that expired;
+    // periodic timers are re-armed. Returns nothing if the wheel is busy.
+    std::vector<std::function<void()>> advance(Clock::time_point now);
+
+    // Cancels every pending timer.
+    void clear();
+
+    // Earliest time advance() may have something to return; time_point::max() if empty.
+    Clock::time_point nextDeadline();
+
+    size_t size() const {
+        return pendingCount.load();
+    }
+
+    bool due(Clock::time_point now) const {
+        return size() > 0 && toTick(now) >= nextCheckTick.load(std::memory_order_relaxed);
+    }
+
+    uint64_t toTick(Clock::time_point time) const {
+        if (time <= origin) {
+            return 0;
+        }
+        return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(time - origin).count());
+    }
+
+    Clock::time_point fromTick(uint64_t tick) const {
+        return origin + std::chrono::milliseconds(tick);
+    }
+
+private:
+    friend class TimerHandle;
+
+    void clearLocked();
+
+    void insertLocked(TimerNode *node);
+
+    void unlinkLocked(TimerNode *node);
+
+    void cascadeLocked(size_t level);
+
+    uint64_t nextExpiryTickLocked() const;
+
+    const Clock::time_point origin;
+    std::shared_ptr<std::mutex> mutex;
+    uint64_t currentTick;
+    std::atomic<size_t> pendingCount;
+    std::atomic<uint64_t> nextCheckTick;
+    std::vector<TimerLink> slots;
+};
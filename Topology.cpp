@@ -0,0 +1,114 @@
+#include "Topology.h"
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    std::string readLine(const std::string &path) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    // Numbers N of the entries called <prefix>N in the directory, sorted.
+    std::vector<int> numberedEntries(const std::string &directory, const std::string &prefix) {
+        std::vector<int> numbers;
+        DIR *dir = opendir(directory.c_str());
+        if (!dir) {
+            return numbers;
+        }
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+                std::all_of(name.begin() + prefix.size(), name.end(), ::isdigit)) {
+                numbers.push_back(std::stoi(name.substr(prefix.size())));
+            }
+        }
+        closedir(dir);
+        std::sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+}
+
+std::vector<int> Topology::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || !::isdigit(range[0])) {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+Topology Topology::read(const std::string &nodeRoot, const std::string &cpuRoot) {
+    Topology topology;
+    for (int id: numberedEntries(nodeRoot, "node")) {
+        std::vector<int> cpus = parseCpuList(readLine(nodeRoot + "/node" + std::to_string(id) + "/cpulist"));
+        // Memory-only nodes have no CPUs to place workers on.
+        if (!cpus.empty()) {
+            topology.numaNodes.push_back({id, cpus});
+        }
+    }
+    if (topology.numaNodes.empty()) {
+        NumaNode node{0, {}};
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+            node.cpus.push_back(int(cpu));
+        }
+        topology.numaNodes.push_back(node);
+    }
+    for (auto &node: topology.numaNodes) {
+        for (int cpu: node.cpus) {
+            std::vector<int> siblings = parseCpuList(
+                    readLine(cpuRoot + "/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"));
+            if (siblings.empty() || siblings.front() == cpu) {
+                topology.coreCpus.push_back(cpu);
+            }
+        }
+    }
+    return topology;
+}
+
+const Topology &Topology::system() {
+    static const Topology topology = read();
+    return topology;
+}
+
+size_t Topology::nodeIndexOfCpu(int cpu) const {
+    for (size_t i = 0; i < numaNodes.size(); i++) {
+        if (std::find(numaNodes[i].cpus.begin(), numaNodes[i].cpus.end(), cpu) != numaNodes[i].cpus.end()) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+bool pinCurrentThread(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu: cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
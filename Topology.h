@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+// CPUs and NUMA nodes as reported by sysfs. When the node directory is missing (non-NUMA
+// kernels, containers without sysfs) everything is one node 0 with hardware_concurrency CPUs.
+class Topology {
+public:
+    static Topology read(const std::string &nodeRoot = "/sys/devices/system/node",
+                         const std::string &cpuRoot = "/sys/devices/system/cpu");
+
+    // Read once on first use.
+    static const Topology &system();
+
+    // Sorted by id.
+    const std::vector<NumaNode> &nodes() const {
+        return numaNodes;
+    }
+
+    // One CPU per physical core (the first of its hyperthread siblings), grouped by node.
+    const std::vector<int> &cores() const {
+        return coreCpus;
+    }
+
+    // Index into nodes() of the node the CPU belongs to, 0 if unknown.
+    size_t nodeIndexOfCpu(int cpu) const;
+
+    // Parses the sysfs list format, e.g. "0-3,8,10-11".
+    static std::vector<int> parseCpuList(const std::string &list);
+
+private:
+    std::vector<NumaNode> numaNodes;
+    std::vector<int> coreCpus;
+};
+
+// Restricts the calling thread to the given CPUs. Returns false if the set is empty or
+// the kernel refused it, e.g. because the CPUs are outside the process's cpuset.
+bool pinCurrentThread(const std::vector<int> &cpus);
@@ -0,0 +1,207 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<TraceBuffer>> registry;
+    // Buffers of exited threads. They stay in the registry, and so in dumps, until a new
+    // thread takes one over, so the registry only grows with the number of threads alive
+    // at once, not with every short-lived thread that ever traced.
+    std::vector<std::shared_ptr<TraceBuffer>> retiredBuffers;
+    uint64_t nextThreadId = 1;
+
+    struct BufferOwner {
+        std::shared_ptr<TraceBuffer> buffer;
+
+        ~BufferOwner() {
+            if (buffer) {
+                std::unique_lock<std::mutex> lock(registryMutex);
+                retiredBuffers.push_back(std::move(buffer));
+            }
+        }
+    };
+
+    struct Event {
+        uint64_t ticks;
+        TraceEventType type;
+        uint64_t flowId;
+        uint64_t parentFlowId;
+        uint64_t threadId;
+    };
+
+    const char *eventName(TraceEventType type) {
+        switch (type) {
+            case TraceEventType::TaskEnqueue:
+                return "enqueue";
+            case TraceEventType::TaskStart:
+            case TraceEventType::TaskEnd:
+                return "task";
+            case TraceEventType::PromiseSet:
+                return "promise set";
+            case TraceEventType::FutureWaitBegin:
+            case TraceEventType::FutureWaitEnd:
+                return "future wait";
+            case TraceEventType::ContinuationDispatch:
+                return "continuation dispatch";
+        }
+        return "unknown";
+    }
+
+    void writeEvent(std::ostream &out, bool &first, const char *name, const char *phase, double ts,
+                    uint64_t threadId) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":\"" << name << "\",\"cat\":\"threadpool\",\"ph\":\"" << phase << "\",\"ts\":" << ts
+            << ",\"pid\":1,\"tid\":" << threadId;
+    }
+
+    void writeArgs(std::ostream &out, const Event &event) {
+        out << ",\"args\":{\"flow_id\":" << event.flowId << ",\"parent_flow_id\":" << event.parentFlowId << "}}";
+    }
+
+    void writeFlow(std::ostream &out, bool &first, const char *phase, double ts, const Event &event) {
+        writeEvent(out, first, "flow", phase, ts, event.threadId);
+        out << ",\"id\":" << event.flowId;
+        if (phase[0] == 'f') {
+            out << ",\"bp\":\"e\"";
+        }
+        out << "}";
+    }
+}
+
+TraceBuffer &Trace::localBuffer() {
+    thread_local BufferOwner owner;
+    if (!owner.buffer) {
+        std::unique_lock<std::mutex> lock(registryMutex);
+        if (retiredBuffers.empty()) {
+            owner.buffer = std::make_shared<TraceBuffer>(nextThreadId++);
+            registry.push_back(owner.buffer);
+        } else {
+            owner.buffer = std::move(retiredBuffers.back());
+            retiredBuffers.pop_back();
+            owner.buffer->reset(nextThreadId++);
+        }
+    }
+    return *owner.buffer;
+}
+
+void Trace::writeJsonString(std::ostream &out, const std::string &text) {
+    out << '"';
+    for (char c: text) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    out << escaped;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+void Trace::setThreadName(const std::string &name) {
+    if (enabled()) {
+        TraceBuffer &buffer = localBuffer();
+        std::unique_lock<std::mutex> lock(registryMutex);
+        buffer.threadName = name;
+    }
+}
+
+void Trace::dumpChromeTrace(std::ostream &out) {
+    std::vector<Event> events;
+    std::vector<std::pair<uint64_t, std::string>> threadNames;
+    {
+        std::unique_lock<std::mutex> lock(registryMutex);
+        for (auto &buffer: registry) {
+            threadNames.emplace_back(buffer->threadId, buffer->threadName);
+            uint64_t end = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = end > TraceBuffer::capacity ? end - TraceBuffer::capacity : 0;
+            std::vector<Event> copied;
+            for (uint64_t i = begin; i < end; i++) {
+                TraceBuffer::Slot &slot = buffer->slots[i & (TraceBuffer::capacity - 1)];
+                copied.push_back({slot.ticks.load(std::memory_order_relaxed),
+                                  TraceEventType(slot.type.load(std::memory_order_relaxed)),
+                                  slot.flowId.load(std::memory_order_relaxed),
+                                  slot.parentFlowId.load(std::memory_order_relaxed),
+                                  buffer->threadId});
+            }
+            // Drop the slots the owner may have overwritten while we were copying.
+            uint64_t newEnd = buffer->head.load(std::memory_order_acquire);
+            uint64_t overwritten = newEnd > TraceBuffer::capacity + begin ? newEnd - TraceBuffer::capacity - begin : 0;
+            copied.erase(copied.begin(), copied.begin() + std::min<uint64_t>(overwritten, copied.size()));
+            events.insert(events.end(), copied.begin(), copied.end());
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+        return a.ticks < b.ticks;
+    });
+
+    uint64_t origin = events.empty() ? 0 : events.front().ticks;
+    bool first = true;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (auto &thread: threadNames) {
+        if (!thread.second.empty()) {
+            writeEvent(out, first, "thread_name", "M", 0, thread.first);
+            out << ",\"args\":{\"name\":";
+            writeJsonString(out, thread.second);
+            out << "}}";
+        }
+    }
+    std::unordered_set<uint64_t> dispatchedFlows;
+    for (auto &event: events) {
+        double ts = ticksToNanoseconds(event.ticks - origin) / 1000.0;
+        const char *name = eventName(event.type);
+        switch (event.type) {
+            case TraceEventType::TaskStart:
+            case TraceEventType::FutureWaitBegin:
+                writeEvent(out, first, name, "B", ts, event.threadId);
+                writeArgs(out, event);
+                if (event.type == TraceEventType::TaskStart) {
+                    writeFlow(out, first, "f", ts, event);
+                }
+                break;
+            case TraceEventType::TaskEnd:
+            case TraceEventType::FutureWaitEnd:
+                if (event.type == TraceEventType::FutureWaitEnd) {
+                    writeFlow(out, first, "f", ts, event);
+                }
+                writeEvent(out, first, name, "E", ts, event.threadId);
+                writeArgs(out, event);
+                break;
+            default:
+                writeEvent(out, first, name, "i", ts, event.threadId);
+                out << ",\"s\":\"t\"";
+                writeArgs(out, event);
+                if (event.type == TraceEventType::ContinuationDispatch) {
+                    dispatchedFlows.insert(event.flowId);
+                    writeFlow(out, first, "s", ts, event);
+                } else if (event.type == TraceEventType::TaskEnqueue && dispatchedFlows.count(event.flowId)) {
+                    writeFlow(out, first, "t", ts, event);
+                } else {
+                    writeFlow(out, first, "s", ts, event);
+                }
+                break;
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "Clock.h"
+
+#ifdef THREADPOOL_TRACE
+constexpr bool traceEnabled = true;
+#else
+constexpr bool traceEnabled = false;
+#endif
+
+enum class TraceEventType : uint64_t {
+    TaskEnqueue,
+    TaskStart,
+    TaskEnd,
+    PromiseSet,
+    FutureWaitBegin,
+    FutureWaitEnd,
+    ContinuationDispatch
+};
+
+// Fixed-size single-writer ring of events; once full, the oldest events are overwritten.
+class TraceBuffer {
+public:
+    static const size_t capacity = 1 << 13;
+
+    struct Slot {
+        std::atomic<uint64_t> ticks;
+        std::atomic<uint64_t> type;
+        std::atomic<uint64_t> flowId;
+        std::atomic<uint64_t> parentFlowId;
+    };
+
+    explicit TraceBuffer(uint64_t threadId) : threadId(threadId), head(0), slots(new Slot[capacity]) {
+    }
+
+    // Hands the buffer of an exited thread to a new one, dropping the old events; only
+    // while no thread records into it.
+    void reset(uint64_t newThreadId) {
+        threadId = newThreadId;
+        threadName.clear();
+        head.store(0, std::memory_order_release);
+    }
+
+    void record(TraceEventType type, uint64_t flowId, uint64_t parentFlowId) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        Slot &slot = slots[index & (capacity - 1)];
+        slot.ticks.store(readTicks(), std::memory_order_relaxed);
+        slot.type.store(uint64_t(type), std::memory_order_relaxed);
+        slot.flowId.store(flowId, std::memory_order_relaxed);
+        slot.parentFlowId.store(parentFlowId, std::memory_order_relaxed);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    uint64_t threadId;
+    std::string threadName;
+    std::atomic<uint64_t> head;
+    std::unique_ptr<Slot[]> slots;
+};
+
+// Task lifecycle tracing. Every thread records into its own TraceBuffer; the buffers are
+// merged only when dumped. Events carry flow ids: a task's enqueue and start share one,
+// as do a Promise completion and the Future wait it ends, so the trace viewer draws
+// arrows along async chains.
+class Trace {
+public:
+    static void setEnabled(bool enabled) {
+        runtimeEnabled().store(enabled, std::memory_order_relaxed);
+    }
+
+    static bool enabled() {
+        return traceEnabled && runtimeEnabled().load(std::memory_order_relaxed);
+    }
+
+    static uint64_t newFlowId() {
+        static std::atomic<uint64_t> nextFlowId(1);
+        return nextFlowId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void record(TraceEventType type, uint64_t flowId, uint64_t parentFlowId = 0) {
+        if (enabled()) {
+            localBuffer().record(type, flowId, parentFlowId);
+        }
+    }
+
+    // Flow id of the task running on this thread, 0 outside of traced tasks.
+    static uint64_t &currentFlowId() {
+        thread_local uint64_t flowId = 0;
+        return flowId;
+    }
+
+    // Flow id that the next ThreadPool::execute() on this thread adopts instead of
+    // allocating its own, so a continuation dispatch and its task form one flow.
+    static uint64_t &pendingTaskFlowId() {
+        thread_local uint64_t flowId = 0;
+        return flowId;
+    }
+
+    // Records the enqueue of a task and returns its flow id: the pending continuation
+    // flow if there is one, otherwise a fresh id.
+    static uint64_t enqueueTask() {
+        if (!enabled()) {
+            return 0;
+        }
+        uint64_t &pending = pendingTaskFlowId();
+        uint64_t flowId = pending ? pending : newFlowId();
+        pending = 0;
+        record(TraceEventType::TaskEnqueue, flowId, currentFlowId());
+        return flowId;
+    }
+
+    static void dispatchContinuation() {
+        if (enabled()) {
+            uint64_t flowId = newFlowId();
+            record(TraceEventType::ContinuationDispatch, flowId, currentFlowId());
+            pendingTaskFlowId() = flowId;
+        }
+    }
+
+    static void setThreadName(const std::string &name);
+
+    // Writes all buffered events as Chrome trace JSON (chrome://tracing, Perfetto).
+    static void dumpChromeTrace(std::ostream &out);
+
+    // Writes text as a quoted JSON string, escaping quotes, backslashes and control characters.
+    static void writeJsonString(std::ostream &out, const std::string &text);
+
+private:
+    static std::atomic<bool> &runtimeEnabled() {
+        static std::atomic<bool> value(true);
+        return value;
+    }
+
+    static TraceBuffer &localBuffer();
+};
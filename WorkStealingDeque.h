@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Unit of work that lives in a worker's deque. Jobs are owned by whoever pushed them
+// (typically a stack frame in ForkJoin.h); the deque only stores pointers.
+class ForkJoinJob {
+public:
+    virtual void execute() = 0;
+
+protected:
+    ~ForkJoinJob() = default;
+};
+
+// Fixed-capacity Chase-Lev deque: the owning worker pushes and pops at the bottom
+// without locks, other workers steal from the top with a CAS.
+class WorkStealingDeque {
+public:
+    enum : size_t {
+        capacity = 4096
+    };
+
+    WorkStealingDeque() : top(0), bottom(0), buffer(new std::atomic<ForkJoinJob *>[capacity]) {
+    }
+
+    // Owner only. Returns false when the deque is full.
+    bool push(ForkJoinJob *job) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= int64_t(capacity)) {
+            return false;
+        }
+        buffer[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only. Takes the most recently pushed job.
+    ForkJoinJob *pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        ForkJoinJob *job = buffer[b & (capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last element: race against thieves for it.
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread. Takes the oldest job, or nullptr if empty or the race was lost.
+    ForkJoinJob *steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        ForkJoinJob *job = buffer[t & (capacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+    bool empty() const {
+        return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::unique_ptr<std::atomic<ForkJoinJob *>[]> buffer;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include "Aligned.h"
+#include "ThreadPool.h"
+
+// One value per worker slot of a ThreadPool, each on its own cache line, plus one for
+// threads outside the pool. local() in a task only touches the running worker's value, so
+// accumulating into it needs neither atomics nor locks. Read the values with combine() or
+// forEach() after joining the tasks that write them.
+//
+// All outside threads share one value, so only one of them may use local() at a time,
+// such as the thread waiting on a TaskGroup, which runs queued children itself.
+template<typename T>
+class WorkerLocal {
+public:
+    explicit WorkerLocal(ThreadPool &pool, const T &initial = T())
+            : pool(pool), count(pool.workerSlots() + 1),
+              slots(makeAlignedArray<Slot>(count)) {
+        for (size_t i = 0; i < count; i++) {
+            slots[i].value = initial;
+        }
+    }
+
+    WorkerLocal(const WorkerLocal &) = delete;
+
+    WorkerLocal &operator=(const WorkerLocal &) = delete;
+
+    // The calling worker's value; the outside threads' one when not called on a worker of
+    // this pool.
+    T &local() {
+        int index = pool.currentWorkerIndex();
+        return slots[index < 0 ? count - 1 : size_t(index)].value;
+    }
+
+    // Folds all values with op, starting from the first slot's.
+    template<typename Op>
+    T combine(Op op) const {
+        T result = slots[0].value;
+        for (size_t i = 1; i < count; i++) {
+            result = op(result, slots[i].value);
+        }
+        return result;
+    }
+
+    template<typename F>
+    void forEach(F function) {
+        for (size_t i = 0; i < count; i++) {
+            function(slots[i].value);
+        }
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    ThreadPool &pool;
+    const size_t count;
+    AlignedArray<Slot> slots;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+class BenchmarkState {
+public:
+    explicit BenchmarkState(size_t iterations) : iterationCount(iterations), elapsedTime(0) {
+    }
+
+    size_t iterations() const {
+        return iterationCount;
+    }
+
+    void start() {
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        elapsedTime += std::chrono::steady_clock::now() - startTime;
+    }
+
+    std::chrono::nanoseconds elapsed() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime);
+    }
+
+private:
+    size_t iterationCount;
+    std::chrono::steady_clock::duration elapsedTime;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+struct Benchmark {
+    std::string name;
+    size_t iterations;
+    std::function<void(BenchmarkState &)> function;
+};
+
+inline std::vector<Benchmark> &benchmarks() {
+    static std::vector<Benchmark> registered;
+    return registered;
+}
+
+struct BenchmarkRegistrar {
+    BenchmarkRegistrar(std::string name, size_t iterations, std::function<void(BenchmarkState &)> function) {
+        benchmarks().push_back({std::move(name), iterations, std::move(function)});
+    }
+};
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+// Registers a function of BenchmarkState& under the given name. The function runs
+// state.iterations() operations and brackets the measured part with start()/stop().
+#define BENCHMARK(name, iterations, ...) \
+    static BenchmarkRegistrar BENCHMARK_CONCAT(benchmarkRegistrar, __LINE__)(name, iterations, __VA_ARGS__)
@@ -0,0 +1,104 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+struct BenchmarkResult {
+    std::string name;
+    size_t iterations;
+    std::vector<double> nsPerOp;
+};
+
+static std::string jsonEscape(const std::string &s) {
+    std::string escaped;
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void writeJson(std::ostream &out, const std::vector<BenchmarkResult> &results, size_t repetitions) {
+    std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n";
+    out << "  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "    \"repetitions\": " << repetitions << "\n";
+    out << "  },\n";
+    out << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        std::vector<double> sorted = results[i].nsPerOp;
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size() / 2];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": \"" << jsonEscape(results[i].name) << "\""
+            << ", \"iterations\": " << results[i].iterations
+            << ", \"ns_per_op\": " << median
+            << ", \"min_ns_per_op\": " << sorted.front()
+            << ", \"max_ns_per_op\": " << sorted.back()
+            << ", \"ops_per_second\": " << (median > 0 ? 1e9 / median : 0) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Usage: benchmarks [--filter=<substring>] [--repetitions=<n>] [--out=<file.json>]
+int main(int argc, char *argv[]) {
+    std::string filter;
+    std::string outputPath;
+    size_t repetitions = 5;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--filter=") == 0) {
+            filter = arg.substr(9);
+        } else if (arg.compare(0, 14, "--repetitions=") == 0) {
+            repetitions = std::max<size_t>(1, std::stoul(arg.substr(14)));
+        } else if (arg.compare(0, 6, "--out=") == 0) {
+            outputPath = arg.substr(6);
+        } else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Benchmark> selected;
+    for (auto &benchmark: benchmarks()) {
+        if (benchmark.name.find(filter) != std::string::npos) {
+            selected.push_back(benchmark);
+        }
+    }
+    std::sort(selected.begin(), selected.end(), [](const Benchmark &a, const Benchmark &b) {
+        return a.name < b.name;
+    });
+
+    std::vector<BenchmarkResult> results;
+    for (auto &benchmark: selected) {
+        BenchmarkResult result{benchmark.name, benchmark.iterations, {}};
+        BenchmarkState warmup(benchmark.iterations);
+        benchmark.function(warmup);
+        for (size_t r = 0; r < repetitions; r++) {
+            BenchmarkState state(benchmark.iterations);
+            benchmark.function(state);
+            result.nsPerOp.push_back(double(state.elapsed().count()) / benchmark.iterations);
+        }
+        std::vector<double> sorted = result.nsPerOp;
+        std::sort(sorted.begin(), sorted.end());
+        std::cerr << benchmark.name << ": " << sorted[sorted.size() / 2] << " ns/op" << std::endl;
+        results.push_back(std::move(result));
+    }
+
+    if (outputPath.empty()) {
+        writeJson(std::cout, results, repetitions);
+    } else {
+        std::ofstream out(outputPath);
+        writeJson(out, results, repetitions);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Benchmark.h"
+#include "../AsyncCache.h"
+#include "../Map.h"
+
+static const size_t kKeys = 64;
+
+// Stands in for an expensive computation.
+static uint64_t spin(uint64_t seed) {
+    uint64_t value = seed;
+    for (int i = 0; i < 20000; i++) {
+        value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return value;
+}
+
+// Requests cycling over kKeys keys, each computed once and then served from the cache.
+BENCHMARK("cache/duplicate_requests/keys:64", 20000, [](BenchmarkState &state) {
+    ThreadPool pool(4);
+    AsyncCache<uint64_t, uint64_t> cache(pool);
+    std::vector<SharedFuture<uint64_t>> futures;
+    futures.reserve(state.iterations());
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        uint64_t key = i % kKeys;
+        futures.push_back(cache.get(key, [key]() {
+            return spin(key);
+        }));
+    }
+    for (auto &future: futures) {
+        future.get();
+    }
+    state.stop();
+});
+
+// The same requests submitted once per caller.
+BENCHMARK("cache/duplicate_requests/uncached", 2000, [](BenchmarkState &state) {
+    ThreadPool pool(4);
+    std::vector<Future<uint64_t>> futures;
+    futures.reserve(state.iterations());
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        uint64_t key = i % kKeys;
+        futures.push_back(submit(pool, [key]() {
+            return spin(key);
+        }));
+    }
+    for (auto &future: futures) {
+        future.get();
+    }
+    state.stop();
+});
+
+BENCHMARK("cache/hit", 1000000, [](BenchmarkState &state) {
+    ThreadPool pool(1);
+    AsyncCache<uint64_t, uint64_t> cache(pool);
+    for (uint64_t key = 0; key < kKeys; key++) {
+        cache.get(key, [key]() {
+            return key;
+        }).get();
+    }
+    uint64_t sum = 0;
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        sum += cache.get(i % kKeys, []() {
+            return uint64_t(0);
+        }).get();
+    }
+    state.stop();
+    if (sum == 0) {
+        std::abort();
+    }
+});
@@ -0,0 +1,90 @@
+#include "Benchmark.h"
+#include "../Channel.h"
+#include <queue>
+
+static const size_t kProducers = 2;
+static const size_t kConsumers = 2;
+
+// kProducers producer and kConsumers consumer tasks on a pool with a worker for each.
+// Producers spin while the channel is full, consumers take batches until all values are in.
+static void channelThroughput(BenchmarkState &state, std::shared_ptr<Channel<size_t>> channel) {
+    ThreadPool pool(kProducers + kConsumers);
+    size_t perProducer = state.iterations() / kProducers;
+    size_t total = perProducer * kProducers;
+    std::atomic<size_t> received(0);
+    state.start();
+    for (size_t p = 0; p < kProducers; p++) {
+        pool.execute([channel, perProducer]() {
+            for (size_t i = 0; i < perProducer; i++) {
+                while (!channel->trySend(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < kConsumers; c++) {
+        pool.execute([channel, total, &received]() {
+            std::vector<size_t> values;
+            while (received.load(std::memory_order_acquire) < total) {
+                values.clear();
+                size_t count = channel->tryRecvMany(values, 64);
+                if (count == 0) {
+                    std::this_thread::yield();
+                } else {
+                    received.fetch_add(count, std::memory_order_acq_rel);
+                }
+            }
+        });
+    }
+    while (received.load(std::memory_order_acquire) < total) {
+        std::this_thread::yield();
+    }
+    state.stop();
+}
+
+BENCHMARK("channel/throughput/bounded:1024/producers:2/consumers:2", 200000, [](BenchmarkState &state) {
+    channelThroughput(state, std::make_shared<Channel<size_t>>(1024));
+});
+
+BENCHMARK("channel/throughput/unbounded/producers:2/consumers:2", 200000, [](BenchmarkState &state) {
+    channelThroughput(state, std::make_shared<Channel<size_t>>());
+});
+
+// The hand-off the channel replaces: a locked std::queue whose consumers wait on a
+// condition variable.
+BENCHMARK("channel/throughput/mutex_queue/producers:2/consumers:2", 200000, [](BenchmarkState &state) {
+    ThreadPool pool(kProducers + kConsumers);
+    std::mutex mutex;
+    std::condition_variable nonEmpty;
+    std::queue<size_t> queue;
+    size_t perProducer = state.iterations() / kProducers;
+    size_t total = perProducer * kProducers;
+    std::atomic<size_t> received(0);
+    state.start();
+    for (size_t p = 0; p < kProducers; p++) {
+        pool.execute([&mutex, &nonEmpty, &queue, perProducer]() {
+            for (size_t i = 0; i < perProducer; i++) {
+                std::unique_lock<std::mutex> lock(mutex);
+                queue.push(i);
+                nonEmpty.notify_one();
+            }
+        });
+    }
+    for (size_t c = 0; c < kConsumers; c++) {
+        pool.execute([&mutex, &nonEmpty, &queue, total, &received]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (received.load(std::memory_order_relaxed) < total) {
+                if (queue.empty()) {
+                    nonEmpty.wait_for(lock, std::chrono::milliseconds(1));
+                    continue;
+                }
+                queue.pop();
+                received.fetch_add(1, std::memory_order_release);
+            }
+        });
+    }
+    while (received.load(std::memory_order_acquire) < total) {
+        std::this_thread::yield();
+    }
+    state.stop();
+});
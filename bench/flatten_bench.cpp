@@ -0,0 +1,40 @@
+#include "Benchmark.h"
+#include "../Promise.h"
+#include "../Flatten.h"
+
+static void flattenCollection(BenchmarkState &state, size_t size) {
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        std::vector<Future<int>> futures;
+        for (size_t j = 0; j < size; j++) {
+            Promise<int> promise;
+            futures.push_back(promise.getFuture());
+            promise.set(int(j));
+        }
+        flatten(futures).get();
+    }
+    state.stop();
+}
+
+BENCHMARK("flatten/collection/futures:10", 2000, [](BenchmarkState &state) {
+    flattenCollection(state, 10);
+});
+
+BENCHMARK("flatten/collection/futures:1000", 200, [](BenchmarkState &state) {
+    flattenCollection(state, 1000);
+});
+
+// Large elements, which flatten moves from the futures into the result.
+BENCHMARK("flatten/collection/payload:8x1MiB", 200, [](BenchmarkState &state) {
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        std::vector<Future<std::vector<char>>> futures;
+        for (size_t j = 0; j < 8; j++) {
+            Promise<std::vector<char>> promise;
+            futures.push_back(promise.getFuture());
+            promise.set(std::vector<char>(1 << 20));
+        }
+        flatten(futures).get();
+    }
+    state.stop();
+});
@@ -0,0 +1,19 @@
+#include "Benchmark.h"
+#include "../FlattenTuple.h"
+#include <vector>
+
+BENCHMARK("flatten/tuple", 2000, [](BenchmarkState &state) {
+    std::vector<int> payload = {1, 2, 3, 4, 5};
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        Promise<int> promiseInt;
+        Promise<std::vector<int>> promiseVector;
+        Promise<Future<std::vector<int>>> promiseFuture;
+        auto tuple = std::make_tuple(int(i), promiseInt.getFuture(), promiseFuture.getFuture());
+        promiseInt.set(1);
+        promiseVector.set(payload);
+        promiseFuture.set(promiseVector.getFuture());
+        flattenTuple(std::move(tuple)).get();
+    }
+    state.stop();
+});
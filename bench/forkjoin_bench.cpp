@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+#include "../ForkJoin.h"
+#include <algorithm>
+#include <random>
+
+static const size_t kPoolThreads = 4;
+
+static long long fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    long long a, b;
+    forkJoin([&a, n]() {
+        a = fib(n - 1);
+    }, [&b, n]() {
+        b = fib(n - 2);
+    });
+    return a + b;
+}
+
+static void quickSort(int *begin, int *end) {
+    if (end - begin < 2048) {
+        std::sort(begin, end);
+        return;
+    }
+    int pivot = begin[(end - begin) / 2];
+    int *middle = std::partition(begin, end, [pivot](int x) {
+        return x < pivot;
+    });
+    int *upper = std::partition(middle, end, [pivot](int x) {
+        return x == pivot;
+    });
+    forkJoin([begin, middle]() {
+        quickSort(begin, middle);
+    }, [upper, end]() {
+        quickSort(upper, end);
+    });
+}
+
+// One op is one fork-join node.
+BENCHMARK("forkjoin/fib:25", 242785, [](BenchmarkState &state) {
+    ThreadPool pool(kPoolThreads);
+    volatile long long result = 0;
+    state.start();
+    runForkJoin(pool, [&result]() {
+        result = fib(25);
+    });
+    state.stop();
+});
+
+// One op is one sorted element.
+BENCHMARK("forkjoin/quicksort:1M", 1 << 20, [](BenchmarkState &state) {
+    ThreadPool pool(kPoolThreads);
+    std::vector<int> values(state.iterations());
+    std::mt19937 random(42);
+    for (auto &value: values) {
+        value = int(random());
+    }
+    state.start();
+    runForkJoin(pool, [&values]() {
+        quickSort(values.data(), values.data() + values.size());
+    });
+    state.stop();
+});
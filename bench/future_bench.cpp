@@ -0,0 +1,42 @@
+#include "Benchmark.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <thread>
+
+BENCHMARK("promise/set_get/same_thread", 200000, [](BenchmarkState &state) {
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        Promise<size_t> promise;
+        Future<size_t> future = promise.getFuture();
+        promise.set(i);
+        future.get();
+    }
+    state.stop();
+});
+
+// Ping-pong between two threads; one operation is a full round trip (two set->get hops).
+BENCHMARK("promise/set_get/cross_thread_round_trip", 20000, [](BenchmarkState &state) {
+    size_t n = state.iterations();
+    std::vector<Promise<size_t>> pings(n);
+    std::vector<Promise<size_t>> pongs(n);
+    std::vector<Future<size_t>> pingFutures;
+    std::vector<Future<size_t>> pongFutures;
+    for (size_t i = 0; i < n; i++) {
+        pingFutures.push_back(pings[i].getFuture());
+        pongFutures.push_back(pongs[i].getFuture());
+    }
+
+    std::thread responder([&]() {
+        for (size_t i = 0; i < n; i++) {
+            pongs[i].set(pingFutures[i].get());
+        }
+    });
+
+    state.start();
+    for (size_t i = 0; i < n; i++) {
+        pings[i].set(i);
+        pongFutures[i].get();
+    }
+    state.stop();
+    responder.join();
+});
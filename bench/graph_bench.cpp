@@ -0,0 +1,46 @@
+#include "Benchmark.h"
+#include "../TaskGraph.h"
+#include "../ThreadPool.h"
+
+// Diamond: a source, width nodes that depend on it and a sink that depends on all of them.
+static void buildDiamond(TaskGraph &graph, size_t width, std::atomic<long> &sum) {
+    TaskGraph::Node source = graph.add([&sum]() {
+        sum++;
+    });
+    TaskGraph::Node sink = graph.add([&sum]() {
+        sum++;
+    });
+    for (size_t i = 0; i < width; i++) {
+        TaskGraph::Node middle = graph.add([&sum]() {
+            sum++;
+        });
+        graph.precede(source, middle);
+        graph.precede(middle, sink);
+    }
+}
+
+static void diamond(BenchmarkState &state, bool reuse) {
+    ThreadPool pool(4);
+    std::atomic<long> sum(0);
+    TaskGraph reused(pool);
+    buildDiamond(reused, 8, sum);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        if (reuse) {
+            reused.run().get();
+        } else {
+            TaskGraph graph(pool);
+            buildDiamond(graph, 8, sum);
+            graph.run().get();
+        }
+    }
+    state.stop();
+}
+
+BENCHMARK("graph/diamond/width:8/reused", 2000, [](BenchmarkState &state) {
+    diamond(state, true);
+});
+
+BENCHMARK("graph/diamond/width:8/rebuilt", 2000, [](BenchmarkState &state) {
+    diamond(state, false);
+});
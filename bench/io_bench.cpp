@@ -0,0 +1,96 @@
+#include "Benchmark.h"
+#include "../IOService.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static const size_t kFiles = 64;
+static const size_t kFileSize = 64 * 1024;
+
+// kFiles files of kFileSize bytes, unlinked once opened; they stay in the page cache, so
+// the benchmarks measure the cost of getting reads to the kernel and results back.
+static const std::vector<int> &files() {
+    static std::vector<int> descriptors;
+    if (descriptors.empty()) {
+        std::vector<char> content(kFileSize, 'x');
+        for (size_t i = 0; i < kFiles; i++) {
+            char pattern[] = "/tmp/io_benchXXXXXX";
+            int fd = mkstemp(pattern);
+            unlink(pattern);
+            if (pwrite(fd, content.data(), content.size(), 0) != ssize_t(content.size())) {
+                std::abort();
+            }
+            descriptors.push_back(fd);
+        }
+    }
+    return descriptors;
+}
+
+static void waitForCount(const std::atomic<size_t> &counter, size_t expected) {
+    while (counter.load(std::memory_order_acquire) != expected) {
+        std::this_thread::yield();
+    }
+}
+
+// What the tasks do today: one blocking pread() per task on the pool's workers.
+BENCHMARK("io/read_files/blocking_tasks", 20000, [](BenchmarkState &state) {
+    const std::vector<int> &fds = files();
+    ThreadPool pool(4);
+    std::atomic<size_t> done(0);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        int fd = fds[i % fds.size()];
+        pool.execute([fd, &done]() {
+            std::unique_ptr<char[]> data(new char[kFileSize]);
+            if (pread(fd, data.get(), kFileSize, 0) != ssize_t(kFileSize)) {
+                std::abort();
+            }
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    waitForCount(done, state.iterations());
+    state.stop();
+});
+
+static void readThroughService(BenchmarkState &state, IOServiceOptions const &options) {
+    const std::vector<int> &fds = files();
+    ThreadPool pool(4);
+    IOService service(pool, options);
+    std::vector<Future<Buffer>> futures;
+    futures.reserve(state.iterations());
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        futures.push_back(service.read(fds[i % fds.size()], kFileSize, 0));
+        // Keeps the registered buffers cycling instead of holding all results.
+        if (futures.size() == 256) {
+            for (auto &future: futures) {
+                if (future.get().size() != kFileSize) {
+                    std::abort();
+                }
+            }
+            futures.clear();
+        }
+    }
+    for (auto &future: futures) {
+        if (future.get().size() != kFileSize) {
+            std::abort();
+        }
+    }
+    state.stop();
+}
+
+BENCHMARK("io/read_files/io_service", 20000, [](BenchmarkState &state) {
+    readThroughService(state, IOServiceOptions());
+});
+
+BENCHMARK("io/read_files/io_service/registered:256", 20000, [](BenchmarkState &state) {
+    IOServiceOptions options;
+    options.registeredBuffers = 256;
+    options.registeredBufferSize = kFileSize;
+    readThroughService(state, options);
+});
+
+BENCHMARK("io/read_files/io_service/fallback", 20000, [](BenchmarkState &state) {
+    IOServiceOptions options;
+    options.useIoUring = false;
+    readThroughService(state, options);
+});
@@ -0,0 +1,108 @@
+#include "Benchmark.h"
+#include "../Map.h"
+
+static void mapChain(BenchmarkState &state, size_t depth) {
+    ThreadPool pool(4);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        Promise<long> promise;
+        promise.setExecutor(&pool);
+        Future<long> future = promise.getFuture();
+        for (size_t d = 0; d < depth; d++) {
+            future = Map(std::move(future), [](long value) {
+                return value + 1;
+            });
+        }
+        promise.set(0);
+        future.get();
+    }
+    state.stop();
+}
+
+BENCHMARK("map/chain/depth:1", 5000, [](BenchmarkState &state) {
+    mapChain(state, 1);
+});
+
+BENCHMARK("map/chain/depth:10", 1000, [](BenchmarkState &state) {
+    mapChain(state, 10);
+});
+
+BENCHMARK("map/chain/depth:100", 100, [](BenchmarkState &state) {
+    mapChain(state, 100);
+});
+
+// Speculative work: a source and a Map over it, of which only every tenth is consumed.
+// The single worker runs everything that was queued before the final get() returns.
+static void speculativeMaps(BenchmarkState &state, bool lazy) {
+    ThreadPool pool(1);
+    auto source = []() {
+        long value = 0;
+        for (int i = 0; i < 2000; i++) {
+            value = value * 31 + i;
+        }
+        return value;
+    };
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        Future<long> future = lazy ? deferred(pool, source) : submit(pool, source);
+        Future<long> mapped = Map(std::move(future), [](long value) {
+            return value + 1;
+        });
+        if (i % 10 == 0) {
+            mapped.get();
+        }
+    }
+    submit(pool, []() {
+        return 0;
+    }).get();
+    state.stop();
+}
+
+BENCHMARK("map/speculative/consumed:10%/eager", 5000, [](BenchmarkState &state) {
+    speculativeMaps(state, false);
+});
+
+BENCHMARK("map/speculative/consumed:10%/deferred", 5000, [](BenchmarkState &state) {
+    speculativeMaps(state, true);
+});
+
+// A failure at the source passed through ten Maps: rethrown and caught in every step, or
+// carried as an Expected error that skips each step's function.
+static void errorChain(BenchmarkState &state, bool exceptions) {
+    ThreadPool pool(4);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        if (exceptions) {
+            Promise<long> promise;
+            promise.setExecutor(&pool);
+            Future<long> future = promise.getFuture();
+            for (size_t d = 0; d < 10; d++) {
+                future = Map(std::move(future), [](long value) {
+                    return value + 1;
+                });
+            }
+            promise.setException(std::make_exception_ptr(std::runtime_error("failed")));
+            future.getResult();
+        } else {
+            Promise<Expected<long, int>> promise;
+            promise.setExecutor(&pool);
+            Future<Expected<long, int>> future = promise.getFuture();
+            for (size_t d = 0; d < 10; d++) {
+                future = MapExpected(std::move(future), [](long value) {
+                    return value + 1;
+                });
+            }
+            promise.setError(1);
+            future.get();
+        }
+    }
+    state.stop();
+}
+
+BENCHMARK("map/error_chain/depth:10/exception", 1000, [](BenchmarkState &state) {
+    errorChain(state, true);
+});
+
+BENCHMARK("map/error_chain/depth:10/expected", 1000, [](BenchmarkState &state) {
+    errorChain(state, false);
+});
@@ -0,0 +1,149 @@
+#include "Benchmark.h"
+#include "../ThreadPool.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include "../TaskGroup.h"
+#include "../LimitedExecutor.h"
+
+static const size_t kPoolThreads = 4;
+
+static void waitForCount(const std::atomic<size_t> &counter, size_t expected) {
+    while (counter.load(std::memory_order_acquire) != expected) {
+        std::this_thread::yield();
+    }
+}
+
+static void executeThroughput(BenchmarkState &state, size_t producers,
+                              ThreadPoolOptions const &options = ThreadPoolOptions()) {
+    ThreadPool pool(kPoolThreads, options);
+    std::atomic<size_t> done(0);
+    size_t perProducer = state.iterations() / producers;
+    size_t total = perProducer * producers;
+
+    state.start();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&pool, &done, perProducer]() {
+            for (size_t i = 0; i < perProducer; i++) {
+                pool.execute([&done]() {
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    waitForCount(done, total);
+    state.stop();
+}
+
+BENCHMARK("pool/execute_throughput/producers:1", 200000, [](BenchmarkState &state) {
+    executeThroughput(state, 1);
+});
+
+BENCHMARK("pool/execute_throughput/producers:4", 200000, [](BenchmarkState &state) {
+    executeThroughput(state, 4);
+});
+
+BENCHMARK("pool/execute_throughput/bounded:1024/producers:4", 200000, [](BenchmarkState &state) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 1024;
+    executeThroughput(state, 4, options);
+});
+
+// Tasks pinned round-robin to the workers with executeOn().
+BENCHMARK("pool/execute_on_throughput", 200000, [](BenchmarkState &state) {
+    ThreadPool pool(kPoolThreads);
+    std::atomic<size_t> done(0);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        pool.executeOn(i % kPoolThreads, [&done]() {
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    waitForCount(done, state.iterations());
+    state.stop();
+});
+
+// Tasks through a bulkhead of 2 slots on the pool: every task past the first two is
+// queued in the executor and handed to the pool by the worker that frees its slot.
+BENCHMARK("pool/limited_throughput/limit:2", 200000, [](BenchmarkState &state) {
+    ThreadPool pool(kPoolThreads);
+    std::shared_ptr<LimitedExecutor> limited = pool.limited(2);
+    std::atomic<size_t> done(0);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        limited->execute([&done]() {
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    waitForCount(done, state.iterations());
+    state.stop();
+});
+
+BENCHMARK("pool/empty_task_round_trip", 20000, [](BenchmarkState &state) {
+    ThreadPool pool(kPoolThreads);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        std::shared_ptr<Promise<void>> promisePtr(new Promise<void>());
+        Future<void> future = promisePtr->getFuture();
+        pool.execute([promisePtr]() {
+            promisePtr->set();
+        });
+        future.get();
+    }
+    state.stop();
+});
+
+// Round trip of a task submitted behind a backlog of background work, once in the same
+// lane and once in the High lane.
+static void roundTripBehindBacklog(BenchmarkState &state, Priority priority) {
+    ThreadPool pool(kPoolThreads);
+    std::atomic<size_t> done(0);
+    size_t backlog = 0;
+    for (size_t i = 0; i < state.iterations(); i++) {
+        for (size_t j = 0; j < 100; j++, backlog++) {
+            pool.execute(Priority::Normal, [&done]() {
+                volatile int spin = 0;
+                while (spin < 1000) {
+                    spin = spin + 1;
+                }
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        std::shared_ptr<Promise<void>> promisePtr(new Promise<void>());
+        Future<void> future = promisePtr->getFuture();
+        state.start();
+        pool.execute(priority, [promisePtr]() {
+            promisePtr->set();
+        });
+        future.get();
+        state.stop();
+    }
+    waitForCount(done, backlog);
+}
+
+BENCHMARK("pool/round_trip_behind_backlog/priority:normal", 200, [](BenchmarkState &state) {
+    roundTripBehindBacklog(state, Priority::Normal);
+});
+
+BENCHMARK("pool/round_trip_behind_backlog/priority:high", 200, [](BenchmarkState &state) {
+    roundTripBehindBacklog(state, Priority::High);
+});
+
+BENCHMARK("taskgroup/run_wait/children:1000", 200, [](BenchmarkState &state) {
+    ThreadPool pool(kPoolThreads);
+    std::atomic<size_t> done(0);
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        TaskGroup group(pool);
+        for (size_t j = 0; j < 1000; j++) {
+            group.run([&done]() {
+                done.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        group.wait();
+    }
+    state.stop();
+});
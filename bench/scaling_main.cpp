@@ -0,0 +1,323 @@
+#include "../Map.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// Scaling and stress harness: runs fixed workloads on pools of 1, 2, 4 ... N workers,
+// reports throughput, efficiency relative to linear scaling and p99/p999 task latency,
+// and fails when throughput drops below a baseline by more than the threshold.
+//
+// Usage: scaling [--max-threads=<n>] [--scale=<x>] [--out=<file.json>]
+//                [--baseline=<file.json>] [--threshold=<fraction>]
+//                [--soak=<seconds>] [--watchdog=<seconds>]
+
+typedef std::chrono::steady_clock Clock;
+
+static std::atomic<uint64_t> progress(0);
+
+struct WorkloadResult {
+    std::string workload;
+    size_t threads;
+    double opsPerSecond;
+    double efficiency;
+    double p99Microseconds;
+    double p999Microseconds;
+};
+
+struct RunResult {
+    size_t operations;
+    double seconds;
+    std::vector<double> latenciesMicroseconds;
+};
+
+static double microsecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static void waitForCount(const std::atomic<size_t> &counter, size_t expected) {
+    while (counter.load(std::memory_order_acquire) < expected) {
+        std::this_thread::yield();
+    }
+}
+
+// Many empty tasks from one producer; latency is execute() -> task start.
+static RunResult tinyTasks(ThreadPool &pool, size_t scale) {
+    size_t n = 100000 * scale;
+    std::vector<double> latencies(n);
+    std::atomic<size_t> done(0);
+    auto start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+        auto enqueuedAt = Clock::now();
+        pool.execute([&latencies, &done, i, enqueuedAt]() {
+            latencies[i] = microsecondsSince(enqueuedAt);
+            done.fetch_add(1, std::memory_order_release);
+            progress.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    waitForCount(done, n);
+    return {n, microsecondsSince(start) / 1e6, std::move(latencies)};
+}
+
+static void spawnFanOut(ThreadPool &pool, size_t depth, std::atomic<size_t> &done) {
+    Promise<size_t> promise;
+    promise.setExecutor(&pool);
+    Map(promise.getFuture(), [&pool, &done](size_t remaining) {
+        if (remaining > 0) {
+            spawnFanOut(pool, remaining - 1, done);
+            spawnFanOut(pool, remaining - 1, done);
+        }
+        done.fetch_add(1, std::memory_order_release);
+        progress.fetch_add(1, std::memory_order_relaxed);
+        return remaining;
+    });
+    promise.set(depth);
+}
+
+// Binary tree of Map continuations, each node spawning its children from a worker.
+static RunResult mapFanOut(ThreadPool &pool, size_t scale) {
+    size_t depth = 14;
+    size_t rounds = scale;
+    size_t nodes = ((size_t(1) << (depth + 1)) - 1) * rounds;
+    std::atomic<size_t> done(0);
+    auto start = Clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        spawnFanOut(pool, depth, done);
+    }
+    waitForCount(done, nodes);
+    return {nodes, microsecondsSince(start) / 1e6, {}};
+}
+
+// Each consumer blocks in Future::get() on a producer that was submitted just before it,
+// so FIFO order keeps the pattern deadlock-free at any worker count.
+static RunResult nestedWaits(ThreadPool &pool, size_t scale) {
+    size_t n = 20000 * scale;
+    std::vector<Promise<int>> promises(n);
+    std::vector<std::shared_ptr<Future<int>>> futures;
+    for (auto &promise: promises) {
+        futures.push_back(std::make_shared<Future<int>>(promise.getFuture()));
+    }
+    std::vector<double> latencies(n);
+    std::atomic<size_t> done(0);
+    auto start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+        Promise<int> *promise = &promises[i];
+        pool.execute([promise, i]() {
+            promise->set(int(i));
+        });
+        std::shared_ptr<Future<int>> future = futures[i];
+        auto enqueuedAt = Clock::now();
+        pool.execute([future, &latencies, &done, i, enqueuedAt]() {
+            future->get();
+            latencies[i] = microsecondsSince(enqueuedAt);
+            done.fetch_add(1, std::memory_order_release);
+            progress.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    waitForCount(done, n);
+    return {n, microsecondsSince(start) / 1e6, std::move(latencies)};
+}
+
+// Many external threads submitting at once.
+static RunResult producerStorm(ThreadPool &pool, size_t scale) {
+    size_t producers = 2 * std::max(1u, std::thread::hardware_concurrency());
+    size_t perProducer = 20000 * scale;
+    size_t n = producers * perProducer;
+    std::vector<double> latencies(n);
+    std::atomic<size_t> done(0);
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; p++) {
+        threads.emplace_back([&pool, &latencies, &done, p, perProducer]() {
+            for (size_t i = p * perProducer; i < (p + 1) * perProducer; i++) {
+                auto enqueuedAt = Clock::now();
+                pool.execute([&latencies, &done, i, enqueuedAt]() {
+                    latencies[i] = microsecondsSince(enqueuedAt);
+                    done.fetch_add(1, std::memory_order_release);
+                    progress.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    waitForCount(done, n);
+    return {n, microsecondsSince(start) / 1e6, std::move(latencies)};
+}
+
+typedef RunResult (*Workload)(ThreadPool &, size_t);
+
+static const std::vector<std::pair<std::string, Workload>> workloads = {
+        {"tiny_tasks",     tinyTasks},
+        {"map_fan_out",    mapFanOut},
+        {"nested_waits",   nestedWaits},
+        {"producer_storm", producerStorm},
+};
+
+static double percentile(std::vector<double> &values, double quantile) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t rank = std::min(values.size() - 1, size_t(quantile * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+static void writeJson(std::ostream &out, const std::vector<WorkloadResult> &results) {
+    out << "{\"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const WorkloadResult &r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "  {\"workload\": \"" << r.workload << "\", \"threads\": " << r.threads
+            << ", \"ops_per_second\": " << r.opsPerSecond << ", \"efficiency\": " << r.efficiency
+            << ", \"p99_us\": " << r.p99Microseconds << ", \"p999_us\": " << r.p999Microseconds << "}";
+    }
+    out << "\n]}\n";
+}
+
+static std::string field(const std::string &line, const std::string &name) {
+    std::string key = "\"" + name + "\": ";
+    size_t position = line.find(key);
+    if (position == std::string::npos) {
+        return "";
+    }
+    position += key.size();
+    size_t end = line.find_first_of(",}", position);
+    std::string value = line.substr(position, end - position);
+    value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+    return value;
+}
+
+// Reads a report written by writeJson(); one result per line.
+static std::map<std::pair<std::string, size_t>, double> readBaseline(const std::string &path) {
+    std::map<std::pair<std::string, size_t>, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string workload = field(line, "workload");
+        if (!workload.empty()) {
+            baseline[{workload, std::stoul(field(line, "threads"))}] = std::stod(field(line, "ops_per_second"));
+        }
+    }
+    return baseline;
+}
+
+static void startWatchdog(double watchdogSeconds) {
+    std::thread([watchdogSeconds]() {
+        uint64_t last = progress.load();
+        auto lastChange = Clock::now();
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            uint64_t current = progress.load();
+            if (current != last) {
+                last = current;
+                lastChange = Clock::now();
+            } else if (microsecondsSince(lastChange) > watchdogSeconds * 1e6) {
+                std::cerr << "watchdog: no task completed for " << watchdogSeconds
+                          << "s, suspected deadlock or lost wakeup" << std::endl;
+                std::abort();
+            }
+        }
+    }).detach();
+}
+
+int main(int argc, char *argv[]) {
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    size_t scale = 1;
+    double threshold = 0.1;
+    double soakSeconds = 0;
+    double watchdogSeconds = 10;
+    std::string outputPath;
+    std::string baselinePath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find('=') + 1);
+        if (arg.compare(0, 14, "--max-threads=") == 0) {
+            maxThreads = std::max<size_t>(1, std::stoul(value));
+        } else if (arg.compare(0, 8, "--scale=") == 0) {
+            scale = std::max<size_t>(1, std::stoul(value));
+        } else if (arg.compare(0, 12, "--threshold=") == 0) {
+            threshold = std::stod(value);
+        } else if (arg.compare(0, 7, "--soak=") == 0) {
+            soakSeconds = std::stod(value);
+        } else if (arg.compare(0, 11, "--watchdog=") == 0) {
+            watchdogSeconds = std::stod(value);
+        } else if (arg.compare(0, 6, "--out=") == 0) {
+            outputPath = value;
+        } else if (arg.compare(0, 11, "--baseline=") == 0) {
+            baselinePath = value;
+        } else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return 2;
+        }
+    }
+    startWatchdog(watchdogSeconds);
+
+    if (soakSeconds > 0) {
+        auto start = Clock::now();
+        size_t rounds = 0;
+        while (microsecondsSince(start) < soakSeconds * 1e6) {
+            for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+                ThreadPool pool(threads);
+                for (auto &workload: workloads) {
+                    workload.second(pool, 1);
+                }
+            }
+            rounds++;
+        }
+        std::cerr << "soak: " << rounds << " rounds without stalls" << std::endl;
+        return 0;
+    }
+
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::vector<WorkloadResult> results;
+    for (auto &workload: workloads) {
+        double singleThreaded = 0;
+        for (size_t threads: threadCounts) {
+            ThreadPool pool(threads);
+            RunResult run = workload.second(pool, scale);
+            double opsPerSecond = run.operations / run.seconds;
+            if (threads == 1) {
+                singleThreaded = opsPerSecond;
+            }
+            WorkloadResult result{workload.first, threads, opsPerSecond,
+                                  singleThreaded > 0 ? opsPerSecond / (singleThreaded * threads) : 0,
+                                  percentile(run.latenciesMicroseconds, 0.99),
+                                  percentile(run.latenciesMicroseconds, 0.999)};
+            std::cerr << result.workload << " threads=" << threads << " ops/s=" << result.opsPerSecond
+                      << " efficiency=" << result.efficiency << " p99=" << result.p99Microseconds << "us"
+                      << " p999=" << result.p999Microseconds << "us" << std::endl;
+            results.push_back(result);
+        }
+    }
+
+    if (outputPath.empty()) {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream out(outputPath);
+        writeJson(out, results);
+    }
+
+    if (baselinePath.empty()) {
+        return 0;
+    }
+    auto baseline = readBaseline(baselinePath);
+    int status = 0;
+    for (auto &result: results) {
+        auto expected = baseline.find({result.workload, result.threads});
+        if (expected != baseline.end() && result.opsPerSecond < expected->second * (1 - threshold)) {
+            std::cerr << "REGRESSION " << result.workload << " threads=" << result.threads << ": "
+                      << result.opsPerSecond << " ops/s vs baseline " << expected->second << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,17 @@
+#include "Benchmark.h"
+#include "../ThreadPool.h"
+
+// Typical timeout usage: arm a timeout per request and cancel it when the request
+// completes, with ~100k timeouts pending at any time.
+BENCHMARK("timer/schedule_cancel/pending:100000", 100000, [](BenchmarkState &state) {
+    ThreadPool pool(2);
+    std::vector<TimerHandle> handles(state.iterations());
+    state.start();
+    for (size_t i = 0; i < state.iterations(); i++) {
+        handles[i] = pool.executeAfter(std::chrono::seconds(30) + std::chrono::milliseconds(i % 1000), []() {});
+    }
+    for (auto &handle: handles) {
+        handle.cancel();
+    }
+    state.stop();
+});
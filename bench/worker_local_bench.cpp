@@ -0,0 +1,44 @@
+#include "Benchmark.h"
+#include "../TaskGroup.h"
+#include "../WorkerLocal.h"
+
+static const size_t kTasks = 64;
+static const size_t kIncrementsPerTask = 10000;
+
+// Every task counts kIncrementsPerTask events into a shared atomic or into its worker's
+// slot; one operation is one increment.
+static void countEvents(BenchmarkState &state, bool workerLocal) {
+    ThreadPool pool(4);
+    std::atomic<long> shared(0);
+    WorkerLocal<long> counts(pool);
+    size_t rounds = std::max<size_t>(1, state.iterations() / (kTasks * kIncrementsPerTask));
+    state.start();
+    for (size_t round = 0; round < rounds; round++) {
+        TaskGroup group(pool);
+        for (size_t task = 0; task < kTasks; task++) {
+            group.run([&shared, &counts, workerLocal]() {
+                if (workerLocal) {
+                    // volatile keeps the increments from being folded into one add.
+                    volatile long &count = counts.local();
+                    for (size_t i = 0; i < kIncrementsPerTask; i++) {
+                        count = count + 1;
+                    }
+                } else {
+                    for (size_t i = 0; i < kIncrementsPerTask; i++) {
+                        shared.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        group.wait();
+    }
+    state.stop();
+}
+
+BENCHMARK("reduce/counter/shared_atomic", 6400000, [](BenchmarkState &state) {
+    countEvents(state, false);
+});
+
+BENCHMARK("reduce/counter/worker_local", 6400000, [](BenchmarkState &state) {
+    countEvents(state, true);
+});
@@ -0,0 +1,168 @@
+#include "../AsyncCache.h"
+#include <gtest/gtest.h>
+
+TEST(asyncCache, concurrentCallersShareOneComputation) {
+    ThreadPool pool(2);
+    AsyncCache<int, int> cache(pool);
+    std::atomic<int> computations(0);
+    std::atomic<bool> release(false);
+    auto compute = [&computations, &release]() {
+        computations++;
+        while (!release.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return 42;
+    };
+    SharedFuture<int> first = cache.get(7, compute);
+    SharedFuture<int> second = cache.get(7, compute);
+    ASSERT_TRUE(first == second);
+    release = true;
+    ASSERT_EQ(first.get(), 42);
+    ASSERT_EQ(second.get(), 42);
+    ASSERT_EQ(cache.get(7, compute).get(), 42);
+    ASSERT_EQ(computations.load(), 1);
+    AsyncCacheStats stats = cache.stats();
+    ASSERT_EQ(stats.misses, 1u);
+    ASSERT_EQ(stats.joins, 1u);
+    ASSERT_EQ(stats.hits, 1u);
+    ASSERT_EQ(stats.size, 1u);
+}
+
+TEST(asyncCache, sharedFutureHasManyWaiters) {
+    ThreadPool pool(1);
+    AsyncCache<int, std::string> cache(pool);
+    std::atomic<bool> release(false);
+    SharedFuture<std::string> future = cache.get(1, [&release]() {
+        while (!release.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return std::string("value");
+    });
+    std::vector<std::thread> waiters;
+    std::atomic<int> seen(0);
+    for (int i = 0; i < 4; i++) {
+        waiters.emplace_back([future, &seen]() {
+            if (future.get() == "value") {
+                seen++;
+            }
+        });
+    }
+    release = true;
+    for (auto &waiter: waiters) {
+        waiter.join();
+    }
+    ASSERT_EQ(seen.load(), 4);
+}
+
+TEST(asyncCache, failuresAreNotCached) {
+    ThreadPool pool(2);
+    AsyncCache<std::string, int> cache(pool);
+    SharedFuture<int> failed = cache.get("key", []() -> int {
+        throw std::runtime_error("failed");
+    });
+    ASSERT_THROW(failed.get(), std::runtime_error);
+    ASSERT_EQ(cache.get("key", []() {
+        return 1;
+    }).get(), 1);
+    AsyncCacheStats stats = cache.stats();
+    ASSERT_EQ(stats.failures, 1u);
+    ASSERT_EQ(stats.misses, 2u);
+}
+
+TEST(asyncCache, clockEvictsUnreferencedEntries) {
+    ThreadPool pool(2);
+    AsyncCacheOptions options;
+    options.capacity = 2;
+    options.shards = 1;
+    AsyncCache<int, int> cache(pool, options);
+    std::atomic<int> computations(0);
+    auto compute = [&computations]() {
+        return ++computations;
+    };
+    cache.get(1, compute).get();
+    cache.get(2, compute).get();
+    // Referencing 1 again makes 2 the victim.
+    cache.get(1, compute).get();
+    cache.get(3, compute).get();
+    ASSERT_EQ(cache.stats().evictions, 1u);
+    ASSERT_EQ(cache.stats().size, 2u);
+    int before = computations.load();
+    cache.get(1, compute).get();
+    ASSERT_EQ(computations.load(), before);
+    cache.get(2, compute).get();
+    ASSERT_EQ(computations.load(), before + 1);
+}
+
+TEST(asyncCache, inFlightEntriesAreNotEvicted) {
+    ThreadPool pool(4);
+    AsyncCacheOptions options;
+    options.capacity = 1;
+    options.shards = 1;
+    AsyncCache<int, int> cache(pool, options);
+    std::atomic<int> computations(0);
+    std::atomic<bool> release(false);
+    auto compute = [&computations, &release]() {
+        int result = ++computations;
+        while (!release.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return result;
+    };
+    SharedFuture<int> first = cache.get(1, compute);
+    SharedFuture<int> second = cache.get(2, compute);
+    // Both in flight: the shard grows instead of dropping the first computation.
+    ASSERT_EQ(cache.stats().size, 2u);
+    ASSERT_TRUE(cache.get(1, compute) == first);
+    release = true;
+    first.get();
+    second.get();
+    ASSERT_EQ(computations.load(), 2);
+    ASSERT_EQ(cache.stats().evictions, 0u);
+    // Once they are done, the next insert shrinks the shard back to its capacity.
+    cache.get(3, []() {
+        return 3;
+    }).get();
+    ASSERT_EQ(cache.stats().size, 1u);
+}
+
+TEST(asyncCache, entriesExpireAfterTtl) {
+    ThreadPool pool(2);
+    AsyncCacheOptions options;
+    options.ttl = std::chrono::milliseconds(20);
+    AsyncCache<int, int> cache(pool, options);
+    std::atomic<int> computations(0);
+    auto compute = [&computations]() {
+        return ++computations;
+    };
+    ASSERT_EQ(cache.get(1, compute).get(), 1);
+    ASSERT_EQ(cache.get(1, compute).get(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    ASSERT_EQ(cache.get(1, compute).get(), 2);
+    ASSERT_EQ(cache.stats().expirations, 1u);
+    cache.invalidate(1);
+    ASSERT_EQ(cache.get(1, compute).get(), 3);
+}
+
+TEST(asyncCache, computationsMayOutliveTheCache) {
+    ThreadPool pool(2);
+    AsyncCacheOptions options;
+    options.ttl = std::chrono::milliseconds(20);
+    Promise<void> gate;
+    Future<void> opened = gate.getFuture();
+    SharedFuture<int> value;
+    SharedFuture<int> failed;
+    {
+        AsyncCache<int, int> cache(pool, options);
+        value = cache.get(1, [&opened]() {
+            opened.wait();
+            return 7;
+        });
+        failed = cache.get(2, [&opened]() -> int {
+            opened.wait();
+            throw std::runtime_error("failed");
+        });
+    }
+    gate.set();
+    ASSERT_EQ(value.get(), 7);
+    ASSERT_THROW(failed.get(), std::runtime_error);
+}
@@ -0,0 +1,189 @@
+#include "../Map.h"
+#include <gtest/gtest.h>
+
+// Occupies the only worker of the pool until the returned promise is set; the pool must
+// not have compensation workers.
+static std::shared_ptr<Promise<void>> blockWorker(ThreadPool &pool) {
+    std::shared_ptr<Promise<void>> release = std::make_shared<Promise<void>>();
+    std::shared_ptr<Future<void>> released = std::make_shared<Future<void>>(release->getFuture());
+    Promise<void> started;
+    Future<void> startedFuture = started.getFuture();
+    pool.execute([released, &started]() {
+        started.set();
+        released->get();
+    });
+    startedFuture.get();
+    return release;
+}
+
+TEST(boundedQueue, pushPopInOrder) {
+    BoundedQueue<int> queue(4);
+    ASSERT_EQ(queue.capacity(), 4u);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.tryPush(std::move(i)));
+    }
+    int value = 42;
+    ASSERT_FALSE(queue.tryPush(std::move(value)));
+    ASSERT_EQ(queue.size(), 4u);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.tryPop(value));
+        ASSERT_EQ(value, i);
+    }
+    ASSERT_FALSE(queue.tryPop(value));
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(boundedQueue, concurrentProducersAndConsumers) {
+    BoundedQueue<size_t> queue(64);
+    const size_t perProducer = 20000;
+    std::atomic<size_t> sum(0);
+    std::atomic<size_t> popped(0);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < 2; p++) {
+        threads.emplace_back([&queue, perProducer]() {
+            for (size_t i = 1; i <= perProducer; i++) {
+                size_t value = i;
+                while (!queue.tryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&queue, &sum, &popped, perProducer]() {
+            size_t value;
+            while (popped.load() < 2 * perProducer) {
+                if (queue.tryPop(value)) {
+                    sum += value;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    ASSERT_EQ(sum, perProducer * (perProducer + 1));
+}
+
+TEST(boundedQueue, rejectsAtRequestedCapacity) {
+    BoundedQueue<int> queue(3);
+    ASSERT_EQ(queue.capacity(), 3u);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 3; i++) {
+            ASSERT_TRUE(queue.tryPush(std::move(i)));
+        }
+        int value = 42;
+        ASSERT_FALSE(queue.tryPush(std::move(value)));
+        ASSERT_EQ(queue.size(), 3u);
+        for (int i = 0; i < 3; i++) {
+            ASSERT_TRUE(queue.tryPop(value));
+            ASSERT_EQ(value, i);
+        }
+    }
+}
+
+TEST(boundedQueue, poolRejectsAtRequestedCapacity) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 3;
+    options.overflowPolicy = OverflowPolicy::Reject;
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(1, options);
+    auto release = blockWorker(pool);
+    for (int i = 0; i < 3; i++) {
+        pool.execute([]() {});
+    }
+    ASSERT_THROW(pool.execute([]() {}), RejectedExecutionError);
+    ASSERT_EQ(pool.stats().queueCapacity, 3u);
+    release->set();
+}
+
+TEST(boundedQueue, rejectPolicyThrowsAndBreaksMapFuture) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 2;
+    options.overflowPolicy = OverflowPolicy::Reject;
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(1, options);
+    auto release = blockWorker(pool);
+    pool.execute([]() {});
+    pool.execute([]() {});
+    ASSERT_THROW(pool.execute([]() {}), RejectedExecutionError);
+
+    Promise<int> promise;
+    promise.setExecutor(&pool);
+    Future<int> mapped = Map(promise.getFuture(), [](int x) {
+        return x + 1;
+    });
+    ASSERT_THROW(mapped.get(), RejectedExecutionError);
+    release->set();
+    ASSERT_EQ(pool.stats().rejectedTasks, 2u);
+    ASSERT_EQ(pool.stats().queueCapacity, 2u);
+}
+
+TEST(boundedQueue, callerRunsPolicyRunsInline) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 2;
+    options.overflowPolicy = OverflowPolicy::CallerRuns;
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(1, options);
+    auto release = blockWorker(pool);
+    pool.execute([]() {});
+    pool.execute([]() {});
+    std::thread::id ranOn;
+    pool.execute([&ranOn]() {
+        ranOn = std::this_thread::get_id();
+    });
+    ASSERT_EQ(ranOn, std::this_thread::get_id());
+    ASSERT_EQ(pool.stats().callerRunTasks, 1u);
+    release->set();
+}
+
+TEST(boundedQueue, dropOldestPolicyKeepsNewest) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 2;
+    options.overflowPolicy = OverflowPolicy::DropOldest;
+    options.maxCompensationWorkers = 0;
+    std::vector<int> ran;
+    std::mutex ranMutex;
+    {
+        ThreadPool pool(1, options);
+        auto release = blockWorker(pool);
+        for (int i = 0; i < 5; i++) {
+            pool.execute([i, &ran, &ranMutex]() {
+                std::unique_lock<std::mutex> lock(ranMutex);
+                ran.push_back(i);
+            });
+        }
+        ASSERT_EQ(pool.stats().droppedTasks, 3u);
+        ASSERT_EQ(pool.stats().queueDepth, 2u);
+        release->set();
+    }
+    ASSERT_EQ(ran, std::vector<int>({3, 4}));
+}
+
+TEST(boundedQueue, blockPolicyWaitsForSpace) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 4;
+    ThreadPool pool(2, options);
+    const size_t n = 10000;
+    std::atomic<size_t> done(0);
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < 3; p++) {
+        producers.emplace_back([&pool, &done]() {
+            for (size_t i = 0; i < n; i++) {
+                pool.execute([&done]() {
+                    done++;
+                });
+            }
+        });
+    }
+    for (auto &producer: producers) {
+        producer.join();
+    }
+    while (done.load() < 3 * n) {
+        std::this_thread::yield();
+    }
+    ThreadPoolStats stats = pool.stats();
+    ASSERT_LE(stats.queueHighWaterMark, 4u);
+    ASSERT_EQ(stats.rejectedTasks + stats.droppedTasks + stats.callerRunTasks, 0u);
+}
@@ -0,0 +1,148 @@
+#include "../Channel.h"
+#include "../Map.h"
+#include <gtest/gtest.h>
+
+TEST(channel, tryOperationsNeverBlock) {
+    Channel<int> channel(2);
+    ASSERT_EQ(channel.capacity(), 2u);
+    ASSERT_TRUE(channel.trySend(1));
+    ASSERT_TRUE(channel.trySend(2));
+    ASSERT_FALSE(channel.trySend(3));
+    int value = 0;
+    ASSERT_TRUE(channel.tryRecv(value));
+    ASSERT_EQ(value, 1);
+    ASSERT_TRUE(channel.tryRecv(value));
+    ASSERT_EQ(value, 2);
+    ASSERT_FALSE(channel.tryRecv(value));
+}
+
+TEST(channel, zeroCapacityIsRejected) {
+    ASSERT_THROW(Channel<int>(0), std::invalid_argument);
+    Channel<int> single(1);
+    ASSERT_EQ(single.capacity(), 1u);
+}
+
+TEST(channel, unboundedSpillsInOrder) {
+    Channel<size_t> channel;
+    ASSERT_EQ(channel.capacity(), 0u);
+    size_t count = 3 * Channel<size_t>::unboundedRingCapacity;
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_TRUE(channel.trySend(i));
+    }
+    ASSERT_EQ(channel.size(), count);
+    std::vector<size_t> values;
+    while (channel.tryRecvMany(values, 100) > 0) {
+    }
+    ASSERT_EQ(values.size(), count);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(values[i], i);
+    }
+}
+
+TEST(channel, recvCompletesOnSend) {
+    Channel<std::string> channel(4);
+    Future<std::string> received = channel.recv();
+    ASSERT_FALSE(received.isReady());
+    Future<void> sent = channel.send("hello");
+    ASSERT_TRUE(sent.isReady());
+    ASSERT_EQ(received.get(), "hello");
+}
+
+TEST(channel, sendCompletesWhenRoomIsMade) {
+    Channel<int> channel(2);
+    ASSERT_TRUE(channel.send(1).isReady());
+    ASSERT_TRUE(channel.send(2).isReady());
+    Future<void> third = channel.send(3);
+    ASSERT_FALSE(third.isReady());
+    ASSERT_EQ(channel.recv().get(), 1);
+    third.get();
+    ASSERT_EQ(channel.recv().get(), 2);
+    ASSERT_EQ(channel.recv().get(), 3);
+}
+
+TEST(channel, recvManyBatches) {
+    Channel<int> channel(8);
+    Future<std::vector<int>> waiting = channel.recvMany(4);
+    ASSERT_TRUE(channel.trySend(1));
+    ASSERT_EQ(waiting.get(), std::vector<int>({1}));
+    for (int i = 2; i <= 6; i++) {
+        ASSERT_TRUE(channel.trySend(i));
+    }
+    ASSERT_EQ(channel.recvMany(4).get(), std::vector<int>({2, 3, 4, 5}));
+    ASSERT_EQ(channel.recvMany(4).get(), std::vector<int>({6}));
+}
+
+TEST(channel, closeDrainsThenFails) {
+    Channel<int> channel(2);
+    ASSERT_TRUE(channel.trySend(1));
+    ASSERT_TRUE(channel.trySend(2));
+    Future<void> parked = channel.send(3);
+    channel.close();
+    ASSERT_TRUE(channel.isClosed());
+    ASSERT_FALSE(channel.trySend(4));
+    ASSERT_THROW(parked.get(), ChannelClosedError);
+    ASSERT_THROW(channel.send(5).get(), ChannelClosedError);
+    ASSERT_EQ(channel.recv().get(), 1);
+    ASSERT_EQ(channel.recv().get(), 2);
+    ASSERT_THROW(channel.recv().get(), ChannelClosedError);
+
+    Channel<int> empty(1);
+    Future<std::vector<int>> waiting = empty.recvMany(2);
+    empty.close();
+    ASSERT_THROW(waiting.get(), ChannelClosedError);
+}
+
+// Producers and consumers are pool tasks using the non-blocking operations; the pool has a
+// worker for each, since producers spin while the channel is full.
+TEST(channel, producersAndConsumersOnPool) {
+    ThreadPool pool(4);
+    std::shared_ptr<Channel<size_t>> channel = std::make_shared<Channel<size_t>>(16);
+    const size_t producers = 2;
+    const size_t perProducer = 2000;
+    std::atomic<size_t> sum(0);
+    std::atomic<size_t> received(0);
+    for (size_t p = 0; p < producers; p++) {
+        pool.execute([channel, p, perProducer]() {
+            for (size_t i = 1; i <= perProducer; i++) {
+                size_t value = p * perProducer + i;
+                while (!channel->trySend(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    const size_t total = producers * perProducer;
+    for (size_t c = 0; c < 2; c++) {
+        pool.execute([channel, &sum, &received]() {
+            std::vector<size_t> values;
+            while (channel->tryRecvMany(values, 64) > 0 || !channel->isClosed()) {
+                for (size_t value: values) {
+                    sum.fetch_add(value);
+                }
+                received.fetch_add(values.size());
+                values.clear();
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (received.load() < total) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    channel->close();
+    ASSERT_EQ(sum.load(), total * (total + 1) / 2);
+}
+
+TEST(channel, recvFutureCarriesCallingPool) {
+    ThreadPool pool(2);
+    Channel<int> channel(4);
+    Future<Future<int>> received = submit(pool, [&channel]() {
+        return channel.recv();
+    });
+    Future<int> value = received.get();
+    ASSERT_EQ(value.getExecutor(), &pool);
+    Future<int> doubled = Map(std::move(value), [](int x) {
+        return 2 * x;
+    });
+    ASSERT_TRUE(channel.trySend(21));
+    ASSERT_EQ(doubled.get(), 42);
+}
@@ -0,0 +1,107 @@
+#include "../Map.h"
+#include "../SharedFuture.h"
+#include <gtest/gtest.h>
+
+TEST(deferred, runsOnlyWhenConsumed) {
+    ThreadPool pool(2);
+    std::atomic<int> runs(0);
+    Future<int> future = deferred(pool, [&runs]() {
+        return ++runs;
+    });
+    ASSERT_TRUE(future.isDeferred());
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(runs.load(), 0);
+    ASSERT_FALSE(future.isReady());
+    ASSERT_EQ(future.get(), 1);
+    ASSERT_FALSE(future.isDeferred());
+    ASSERT_EQ(runs.load(), 1);
+}
+
+TEST(deferred, startSchedulesWithoutWaiting) {
+    ThreadPool pool(2);
+    std::atomic<int> runs(0);
+    Future<int> future = deferred(pool, [&runs]() {
+        return ++runs;
+    });
+    future.start();
+    while (!future.isReady()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(runs.load(), 1);
+    ASSERT_EQ(future.get(), 1);
+}
+
+TEST(deferred, droppingFreesWithoutRunning) {
+    ThreadPool pool(2);
+    std::atomic<int> runs(0);
+    std::shared_ptr<int> captured = std::make_shared<int>(0);
+    {
+        Future<int> future = deferred(pool, [&runs, captured]() {
+            return ++runs;
+        });
+        Future<int> mapped = Map(std::move(future), [captured](int value) {
+            return value + 1;
+        });
+        ASSERT_TRUE(mapped.isDeferred());
+        ASSERT_EQ(captured.use_count(), 3);
+    }
+    ASSERT_EQ(captured.use_count(), 1);
+    Future<int> replaced = deferred(pool, [&runs, captured]() {
+        return ++runs;
+    });
+    replaced = deferred(pool, []() {
+        return 0;
+    });
+    ASSERT_EQ(captured.use_count(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(runs.load(), 0);
+}
+
+TEST(deferred, mapChainStartsFromTheEnd) {
+    ThreadPool pool(2);
+    std::atomic<int> runs(0);
+    Future<int> source = deferred(pool, [&runs]() {
+        runs++;
+        return 20;
+    });
+    Future<int> plusOne = Map(std::move(source), [&runs](int value) {
+        runs++;
+        return value + 1;
+    });
+    Future<int> doubled = Map(std::move(plusOne), [&runs](int value) {
+        runs++;
+        return value * 2;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(runs.load(), 0);
+    ASSERT_EQ(doubled.get(), 42);
+    ASSERT_EQ(runs.load(), 3);
+}
+
+TEST(deferred, sharingStarts) {
+    ThreadPool pool(1);
+    SharedFuture<int> shared(deferred(pool, []() {
+        return 7;
+    }));
+    ASSERT_EQ(shared.get(), 7);
+}
+
+TEST(deferred, voidAndReferenceResults) {
+    ThreadPool pool(2);
+    std::atomic<int> runs(0);
+    Future<void> done = deferred(pool, [&runs]() {
+        runs++;
+    });
+    int target = 5;
+    Future<int &> reference = deferred(pool, [&runs, &target]() -> int & {
+        runs++;
+        return target;
+    });
+    ASSERT_TRUE(done.isDeferred());
+    ASSERT_TRUE(reference.isDeferred());
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(runs.load(), 0);
+    done.get();
+    ASSERT_EQ(&reference.get(), &target);
+    ASSERT_EQ(runs.load(), 2);
+}
@@ -0,0 +1,145 @@
+#include "../Map.h"
+#include <gtest/gtest.h>
+
+TEST(expected, holdsValueOrError) {
+    Expected<std::string, int> value(std::string("ok"));
+    ASSERT_TRUE(value.hasValue());
+    ASSERT_EQ(value.value(), "ok");
+    Expected<std::string, int> error(unexpected(7));
+    ASSERT_FALSE(error);
+    ASSERT_EQ(error.error(), 7);
+    ASSERT_THROW(error.value(), BadExpectedAccess);
+    ASSERT_EQ(error.valueOr("fallback"), "fallback");
+    error = value;
+    ASSERT_EQ(error.value(), "ok");
+}
+
+TEST(expected, setErrorCompletesWithoutException) {
+    Promise<Expected<int, std::string>> promise;
+    Future<Expected<int, std::string>> future = promise.getFuture();
+    promise.setError("bad input");
+    Expected<int, std::string> result = future.get();
+    ASSERT_FALSE(result.hasValue());
+    ASSERT_EQ(result.error(), "bad input");
+}
+
+TEST(expected, getResultReturnsExceptionAsError) {
+    Promise<int> failing;
+    Future<int> failed = failing.getFuture();
+    failing.setException(std::make_exception_ptr(std::runtime_error("boom")));
+    Expected<int, std::exception_ptr> result = failed.getResult();
+    ASSERT_FALSE(result.hasValue());
+    ASSERT_THROW(std::rethrow_exception(result.error()), std::runtime_error);
+
+    Promise<int> succeeding;
+    Future<int> succeeded = succeeding.getFuture();
+    succeeding.set(3);
+    ASSERT_EQ(succeeded.getResult().value(), 3);
+}
+
+TEST(expected, mapExpectedSkipsFunctionOnError) {
+    ThreadPool pool(2);
+    std::atomic<int> calls(0);
+    Promise<Expected<int, std::string>> promise;
+    promise.setExecutor(&pool);
+    Future<Expected<int, std::string>> future = promise.getFuture();
+    Future<Expected<int, std::string>> doubled = MapExpected(std::move(future), [&calls](int value) {
+        calls++;
+        return value * 2;
+    });
+    Future<Expected<std::string, std::string>> described = MapExpected(std::move(doubled), [&calls](int value) {
+        calls++;
+        return std::to_string(value);
+    });
+    promise.setError("lost");
+    Expected<std::string, std::string> result = described.get();
+    ASSERT_EQ(result.error(), "lost");
+    ASSERT_EQ(calls.load(), 0);
+}
+
+TEST(expected, mapExpectedFlattensReturnedExpected) {
+    ThreadPool pool(2);
+    Promise<Expected<int, std::string>> promise;
+    promise.setExecutor(&pool);
+    Future<Expected<int, std::string>> future = promise.getFuture();
+    Future<Expected<int, std::string>> checked = MapExpected(std::move(future),
+                                                             [](int value) -> Expected<int, std::string> {
+        if (value < 0) {
+            return unexpected(std::string("negative"));
+        }
+        return value + 1;
+    }, pool);
+    promise.set(41);
+    ASSERT_EQ(checked.get().value(), 42);
+}
+
+TEST(expected, mapPropagatesExceptions) {
+    ThreadPool pool(2);
+    Promise<int> promise;
+    promise.setExecutor(&pool);
+    Future<int> future = promise.getFuture();
+    Future<int> mapped = Map(Map(std::move(future), [](int) -> int {
+        throw std::invalid_argument("first");
+    }), [](int value) {
+        return value + 1;
+    });
+    promise.set(1);
+    ASSERT_THROW(mapped.get(), std::invalid_argument);
+}
+
+// Counts live instances; copies throw while failCopies is set.
+struct Fragile {
+    static int live;
+    static bool failCopies;
+    int value;
+
+    Fragile(int value) : value(value) {
+        live++;
+    }
+
+    Fragile(const Fragile &other) : value(other.value) {
+        if (failCopies) {
+            throw std::runtime_error("copy failed");
+        }
+        live++;
+    }
+
+    Fragile &operator=(const Fragile &other) {
+        if (failCopies) {
+            throw std::runtime_error("copy failed");
+        }
+        value = other.value;
+        return *this;
+    }
+
+    ~Fragile() {
+        live--;
+    }
+};
+
+int Fragile::live = 0;
+bool Fragile::failCopies = false;
+
+TEST(expected, throwingAssignmentKeepsTheOldContents) {
+    static_assert(!std::is_nothrow_move_constructible<Expected<Fragile, std::string>>::value,
+                  "a throwing T makes the move throwing");
+    static_assert(std::is_nothrow_move_constructible<Expected<int, std::string>>::value,
+                  "nothrow members keep the move nothrow");
+    {
+        Expected<Fragile, std::string> value(Fragile(1));
+        Expected<Fragile, std::string> other(Fragile(2));
+        Expected<Fragile, std::string> error(unexpected(std::string("failed")));
+        Fragile::failCopies = true;
+        ASSERT_THROW(value = other, std::runtime_error);
+        ASSERT_THROW(error = other, std::runtime_error);
+        Fragile::failCopies = false;
+        ASSERT_EQ(value.value().value, 1);
+        ASSERT_EQ(error.error(), "failed");
+        error = other;
+        ASSERT_EQ(error.value().value, 2);
+        value = Expected<Fragile, std::string>(unexpected(std::string("replaced")));
+        ASSERT_EQ(value.error(), "replaced");
+        ASSERT_EQ(Fragile::live, 2);
+    }
+    ASSERT_EQ(Fragile::live, 0);
+}
@@ -471,4 +471,34 @@ TEST_F(TestInitCT, testVectorAsync) {
     }
     std::vector<int> c = g.Get();
     ASSERT_EQ(ansV, c);
-}
\ No newline at end of file
+}
+TEST(flatten, collectionOfMoveOnlyValues) {
+    std::vector<Promise<std::unique_ptr<int>>> promises(3);
+    std::vector<Future<std::unique_ptr<int>>> futures;
+    for (auto &promise: promises) {
+        futures.push_back(promise.GetFuture());
+    }
+    Future<std::vector<std::unique_ptr<int>>> flattened = flatten(futures);
+    for (int i = 0; i < 3; i++) {
+        promises[i].Set(std::unique_ptr<int>(new int(i)));
+    }
+    std::vector<std::unique_ptr<int>> values = flattened.Get();
+    ASSERT_EQ(values.size(), 3u);
+    ASSERT_EQ(*values[2], 2);
+}
+
+TEST(flatten, collectionMayGoAwayFirst) {
+    std::vector<Promise<int>> promises(3);
+    Future<std::vector<int>> flattened;
+    {
+        std::vector<Future<int>> futures;
+        for (auto &promise: promises) {
+            futures.push_back(promise.GetFuture());
+        }
+        flattened = flatten(futures);
+    }
+    for (int i = 0; i < 3; i++) {
+        promises[i].Set(i);
+    }
+    ASSERT_EQ(flattened.Get(), std::vector<int>({0, 1, 2}));
+}
@@ -0,0 +1,19 @@
+#include "../FlattenTuple.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+TEST(flattenTuple, movesValuesWithoutCopying) {
+    Promise<std::unique_ptr<int>> promisePointer;
+    Promise<Future<std::string>> promiseNested;
+    Promise<std::string> promiseString;
+    auto tuple = std::make_tuple(std::unique_ptr<int>(new int(1)), promisePointer.getFuture(),
+                                 promiseNested.getFuture());
+    promisePointer.set(std::unique_ptr<int>(new int(2)));
+    promiseString.set(std::string(1 << 20, 'x'));
+    promiseNested.set(promiseString.getFuture());
+    auto result = flattenTuple(std::move(tuple)).get();
+    ASSERT_EQ(*std::get<0>(result), 1);
+    ASSERT_EQ(*std::get<1>(result), 2);
+    ASSERT_EQ(std::get<2>(result).size(), size_t(1) << 20);
+}
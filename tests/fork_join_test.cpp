@@ -0,0 +1,75 @@
+#include "../ForkJoin.h"
+#include <gtest/gtest.h>
+
+static long long fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    long long a, b;
+    forkJoin([&a, n]() {
+        a = fib(n - 1);
+    }, [&b, n]() {
+        b = fib(n - 2);
+    });
+    return a + b;
+}
+
+TEST(forkJoin, recursiveFib) {
+    ThreadPool pool(4);
+    long long result = 0;
+    runForkJoin(pool, [&result]() {
+        result = fib(20);
+    });
+    ASSERT_EQ(result, 6765);
+}
+
+TEST(forkJoin, singleWorker) {
+    ThreadPool pool(1);
+    long long result = 0;
+    runForkJoin(pool, [&result]() {
+        result = fib(15);
+    });
+    ASSERT_EQ(result, 610);
+}
+
+TEST(forkJoin, worksOutsidePool) {
+    ASSERT_EQ(fib(10), 55);
+}
+
+TEST(forkJoin, forkedExceptionIsRethrownByJoin) {
+    ThreadPool pool(2);
+    std::atomic<bool> firstRan(false);
+    ASSERT_THROW(runForkJoin(pool, [&firstRan]() {
+        forkJoin([&firstRan]() {
+            firstRan = true;
+        }, []() {
+            throw std::runtime_error("forked");
+        });
+    }), std::runtime_error);
+    ASSERT_TRUE(firstRan);
+}
+
+TEST(forkJoin, forkedChildFinishesWhenFirstThrows) {
+    ThreadPool pool(2);
+    std::atomic<bool> secondRan(false);
+    ASSERT_THROW(runForkJoin(pool, [&secondRan]() {
+        forkJoin([]() {
+            throw std::runtime_error("inline");
+        }, [&secondRan]() {
+            secondRan = true;
+        });
+    }), std::runtime_error);
+    ASSERT_TRUE(secondRan);
+}
+
+TEST(forkJoin, stolenJobsAreCounted) {
+#ifndef THREADPOOL_STATS
+    GTEST_SKIP() << "worker counters need THREADPOOL_STATS";
+#endif
+    ThreadPool pool(4);
+    runForkJoin(pool, []() {
+        fib(22);
+    });
+    ThreadPoolStats stats = pool.stats();
+    ASSERT_GT(stats.total.tasksExecuted, 1u);
+}
@@ -0,0 +1,89 @@
+#include "../Histogram.h"
+#include "../ThreadPool.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <gtest/gtest.h>
+
+TEST(histogram, bucketsCoverValues) {
+    for (uint64_t value: {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+        size_t bucket = HistogramBuckets::index(value);
+        ASSERT_LT(bucket, HistogramBuckets::bucketCount);
+        ASSERT_LE(HistogramBuckets::lowerBound(bucket), value);
+        ASSERT_GE(HistogramBuckets::upperBound(bucket), value);
+    }
+}
+
+TEST(histogram, percentilesOfUniformValues) {
+    LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        histogram.record(i);
+    }
+    HistogramSnapshot snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.count(), 1000u);
+    double p50 = snapshot.percentile(0.5) / nanosecondsPerTick();
+    double p99 = snapshot.percentile(0.99) / nanosecondsPerTick();
+    ASSERT_NEAR(p50, 500, 500 * 0.07);
+    ASSERT_NEAR(p99, 990, 990 * 0.07);
+}
+
+TEST(histogram, mergeAddsCounts) {
+    LatencyHistogram first;
+    LatencyHistogram second;
+    first.record(10);
+    second.record(20);
+    second.record(30);
+    HistogramSnapshot merged = first.snapshot();
+    merged.merge(second.snapshot());
+    ASSERT_EQ(merged.count(), 3u);
+}
+
+TEST(histogram, poolRecordsTaskLatencies) {
+    ThreadPool pool(2);
+    const int n = 50;
+    std::vector<Promise<void>> promises(n);
+    std::vector<Future<void>> futures;
+    for (int i = 0; i < n; i++) {
+        futures.push_back(promises[i].getFuture());
+        Promise<void> *promise = &promises[i];
+        pool.execute([promise]() {
+            promise->set();
+        });
+    }
+    for (auto &future: futures) {
+        future.get();
+    }
+    if (histogramsEnabled) {
+        ASSERT_EQ(pool.queueWaitHistogram().count(), uint64_t(n));
+        ASSERT_GE(pool.executionHistogram().percentiles().count, 1u);
+    } else {
+        ASSERT_EQ(pool.queueWaitHistogram().count(), 0u);
+    }
+}
+
+TEST(histogram, futureWakeupRecorded) {
+    uint64_t before = futureWakeupHistogram().count();
+    Promise<int> promise;
+    Future<int> future = promise.getFuture();
+    std::thread thread([&promise]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        promise.set(1);
+    });
+    ASSERT_EQ(future.get(), 1);
+    thread.join();
+    if (histogramsEnabled) {
+        ASSERT_EQ(futureWakeupHistogram().count(), before + 1);
+    }
+}
+
+TEST(histogram, exitedThreadsFoldIntoRetiredCounts) {
+    FutureWakeupHistograms &histograms = FutureWakeupHistograms::instance();
+    size_t liveBefore = histograms.size();
+    uint64_t before = histograms.snapshot().count();
+    for (int i = 0; i < 10; i++) {
+        std::thread([&histograms]() {
+            histograms.local().record(1);
+        }).join();
+    }
+    ASSERT_EQ(histograms.size(), liveBefore);
+    ASSERT_EQ(histograms.snapshot().count(), before + 10);
+}
@@ -0,0 +1,117 @@
+#include "../IOService.h"
+#include "../Map.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+// Temporary file with the given content, unlinked once opened.
+static int makeFile(const std::string &content) {
+    char pattern[] = "/tmp/io_service_testXXXXXX";
+    int fd = mkstemp(pattern);
+    unlink(pattern);
+    EXPECT_EQ(pwrite(fd, content.data(), content.size(), 0), ssize_t(content.size()));
+    return fd;
+}
+
+static IOServiceOptions optionsFor(bool useIoUring) {
+    IOServiceOptions options;
+    options.useIoUring = useIoUring;
+    options.queueDepth = 4;
+    options.registeredBuffers = 2;
+    options.registeredBufferSize = 4096;
+    return options;
+}
+
+TEST(ioService, readIntoBuffer) {
+    int fd = makeFile("hello, world");
+    ThreadPool pool(2);
+    for (bool useIoUring: {true, false}) {
+        IOService service(pool, optionsFor(useIoUring));
+        if (!useIoUring) {
+            ASSERT_FALSE(service.usesIoUring());
+        }
+        Buffer buffer = service.read(fd, 5, 7).get();
+        ASSERT_EQ(std::string(buffer.data(), buffer.size()), "world");
+        ASSERT_TRUE(buffer.isRegistered());
+        // Past the registered buffer size, and past the end of the file.
+        Buffer large = service.read(fd, 10000, 0).get();
+        ASSERT_FALSE(large.isRegistered());
+        ASSERT_EQ(std::string(large.data(), large.size()), "hello, world");
+        ASSERT_EQ(service.read(fd, 16, 100).get().size(), 0u);
+    }
+    close(fd);
+}
+
+TEST(ioService, registeredBuffersAreReused) {
+    int fd = makeFile(std::string(100, 'x'));
+    ThreadPool pool(1);
+    IOService service(pool, optionsFor(true));
+    std::vector<Future<Buffer>> futures;
+    for (int i = 0; i < 3; i++) {
+        futures.push_back(service.read(fd, 10, 0));
+    }
+    std::vector<Buffer> buffers;
+    for (auto &future: futures) {
+        buffers.push_back(future.get());
+    }
+    ASSERT_TRUE(buffers[0].isRegistered());
+    ASSERT_TRUE(buffers[1].isRegistered());
+    ASSERT_FALSE(buffers[2].isRegistered());
+    buffers.clear();
+    ASSERT_TRUE(service.read(fd, 10, 0).get().isRegistered());
+    close(fd);
+}
+
+TEST(ioService, writeThenReadBack) {
+    int fd = makeFile("");
+    ThreadPool pool(2);
+    for (bool useIoUring: {true, false}) {
+        IOService service(pool, optionsFor(useIoUring));
+        std::string text = useIoUring ? "ring" : "pool";
+        ASSERT_EQ(service.write(fd, text.data(), text.size(), 0).get(), 4u);
+        char data[4];
+        ASSERT_EQ(service.read(fd, data, sizeof(data), 0).get(), 4u);
+        ASSERT_EQ(std::string(data, 4), text);
+    }
+    close(fd);
+}
+
+TEST(ioService, manyRequestsPastQueueDepth) {
+    std::string content;
+    for (int i = 0; i < 256; i++) {
+        content += char('a' + i % 26);
+    }
+    int fd = makeFile(content);
+    ThreadPool pool(2);
+    for (bool useIoUring: {true, false}) {
+        IOService service(pool, optionsFor(useIoUring));
+        std::vector<Future<Buffer>> futures;
+        for (size_t i = 0; i < content.size(); i++) {
+            futures.push_back(service.read(fd, 1, i));
+        }
+        for (size_t i = 0; i < content.size(); i++) {
+            Buffer buffer = futures[i].get();
+            ASSERT_EQ(buffer.size(), 1u);
+            ASSERT_EQ(buffer.data()[0], content[i]);
+        }
+    }
+    close(fd);
+}
+
+TEST(ioService, errorsAndContinuations) {
+    int fd = makeFile("42");
+    ThreadPool pool(2);
+    for (bool useIoUring: {true, false}) {
+        IOService service(pool, optionsFor(useIoUring));
+        ASSERT_THROW(service.read(-1, 4, 0).get(), std::system_error);
+        Future<Buffer> read = service.read(fd, 2, 0);
+        ASSERT_EQ(read.getExecutor(), &pool);
+        Future<int> parsed = Map(std::move(read), [&pool](Buffer buffer) {
+            EXPECT_EQ(ThreadPool::localThreadPoolPtr, &pool);
+            return std::stoi(std::string(buffer.data(), buffer.size()));
+        });
+        ASSERT_EQ(parsed.get(), 42);
+    }
+    close(fd);
+}
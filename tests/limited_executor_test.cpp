@@ -0,0 +1,109 @@
+#include "../LimitedExecutor.h"
+#include "../Map.h"
+#include <gtest/gtest.h>
+
+static void waitUntil(const std::function<bool()> &condition) {
+    while (!condition()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(limitedExecutor, capsConcurrentTasks) {
+    ThreadPool pool(4);
+    std::shared_ptr<LimitedExecutor> limited = pool.limited(2);
+    ASSERT_EQ(limited->limit(), 2u);
+    std::atomic<size_t> running(0);
+    std::atomic<size_t> maxRunning(0);
+    std::atomic<size_t> done(0);
+    for (int i = 0; i < 20; i++) {
+        limited->execute([&running, &maxRunning, &done]() {
+            size_t now = running.fetch_add(1) + 1;
+            size_t seen = maxRunning.load();
+            while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            running.fetch_sub(1);
+            done.fetch_add(1);
+        });
+    }
+    waitUntil([&done, &limited]() {
+        return done.load() == 20 && limited->stats().running == 0;
+    });
+    ASSERT_LE(maxRunning.load(), 2u);
+    LimitedExecutorStats stats = limited->stats();
+    ASSERT_EQ(stats.tasksExecuted, 20u);
+    ASSERT_EQ(stats.queueDepth, 0u);
+    ASSERT_GT(stats.tasksQueued, 0u);
+    ASSERT_GT(stats.queueHighWaterMark, 0u);
+}
+
+TEST(limitedExecutor, queuedTasksDoNotHoldWorkers) {
+    ThreadPool pool(2);
+    std::shared_ptr<LimitedExecutor> limited = pool.limited(1);
+    std::atomic<bool> release(false);
+    std::atomic<size_t> done(0);
+    for (int i = 0; i < 5; i++) {
+        limited->execute([&release, &done]() {
+            waitUntil([&release]() {
+                return release.load();
+            });
+            done.fetch_add(1);
+        });
+    }
+    ASSERT_EQ(limited->stats().queueDepth, 4u);
+    // The second worker is free for the rest of the pool while the executor is full.
+    std::atomic<bool> ran(false);
+    pool.execute([&ran]() {
+        ran = true;
+    });
+    waitUntil([&ran]() {
+        return ran.load();
+    });
+    ASSERT_EQ(pool.stats().queueDepth, 0u);
+    release = true;
+    waitUntil([&done]() {
+        return done.load() == 5;
+    });
+}
+
+TEST(limitedExecutor, submitAndMapStayOnExecutor) {
+    ThreadPool pool(2);
+    std::shared_ptr<LimitedExecutor> limited = pool.limited(1);
+    Future<int> submitted = submit(*limited, []() {
+        return 20;
+    });
+    ASSERT_EQ(submitted.getExecutor(), limited.get());
+    Future<int> mapped = Map(std::move(submitted), [](int value) {
+        return value + 1;
+    });
+    Future<int> doubled = Map(std::move(mapped), [](int value) {
+        return value * 2;
+    });
+    ASSERT_EQ(doubled.get(), 42);
+    waitUntil([&limited]() {
+        return limited->stats().tasksExecuted == 3;
+    });
+}
+
+TEST(limitedExecutor, submitStoresException) {
+    ThreadPool pool(1);
+    Future<int> failed = submit(pool, []() -> int {
+        throw std::logic_error("failed");
+    });
+    ASSERT_THROW(failed.get(), std::logic_error);
+}
+
+TEST(limitedExecutor, submitVoidTask) {
+    ThreadPool pool(2);
+    std::shared_ptr<LimitedExecutor> limited = pool.limited(1);
+    std::atomic<int> runs(0);
+    Future<void> done = submit(*limited, [&runs]() {
+        runs++;
+    });
+    done.get();
+    ASSERT_EQ(runs.load(), 1);
+    Future<void> failed = submit(*limited, []() {
+        throw std::logic_error("failed");
+    });
+    ASSERT_THROW(failed.get(), std::logic_error);
+}
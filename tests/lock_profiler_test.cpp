@@ -0,0 +1,65 @@
+#include "../LockProfiler.h"
+#include "../ThreadPool.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <thread>
+#include <gtest/gtest.h>
+
+TEST(lockProfiler, countsContendedAcquisitions) {
+    LockProfiler::reset();
+    ProfiledMutex mutex;
+    std::unique_lock<ProfiledMutex> held = lockAt(mutex, LockSite::Other);
+    std::thread contender([&mutex]() {
+        std::unique_lock<ProfiledMutex> lock = lockAt(mutex, LockSite::Other);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    held.unlock();
+    contender.join();
+
+    LockSiteStats stats = LockProfiler::stats(LockSite::Other);
+    ASSERT_EQ(stats.acquisitions, 2u);
+    ASSERT_EQ(stats.contendedAcquisitions, 1u);
+    ASSERT_GE(stats.waitNanoseconds, 10000000u);
+}
+
+TEST(lockProfiler, attributesPoolAndStateLocks) {
+    LockProfiler::reset();
+    {
+        ThreadPool pool(2);
+        Promise<int> promise;
+        Future<int> future = promise.getFuture();
+        // Late enough that get() blocks on the state mutex rather than finding the value.
+        pool.execute([&promise]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            promise.set(1);
+        });
+        ASSERT_EQ(future.get(), 1);
+    }
+    if (lockProfileEnabled) {
+        ASSERT_GE(LockProfiler::stats(LockSite::Execute).acquisitions, 1u);
+        ASSERT_GE(LockProfiler::stats(LockSite::WorkerPop).acquisitions, 1u);
+        ASSERT_GE(LockProfiler::stats(LockSite::PromiseSet).acquisitions, 1u);
+        ASSERT_GE(LockProfiler::stats(LockSite::FutureWait).acquisitions, 1u);
+        ASSERT_NE(LockProfiler::report().find("Promise::set: acquisitions="), std::string::npos);
+    }
+}
+
+TEST(lockProfiler, sitesDoNotLeakIntoLaterLocks) {
+    LockProfiler::reset();
+    ProfiledMutex mutex;
+    {
+        std::unique_lock<ProfiledMutex> lock = lockAt(mutex, LockSite::Execute);
+    }
+    {
+        std::unique_lock<ProfiledMutex> lock(mutex);
+    }
+    {
+        Promise<int> promise;
+        promise.getFuture();
+    }
+    if (lockProfileEnabled) {
+        ASSERT_EQ(LockProfiler::stats(LockSite::Execute).acquisitions, 1u);
+        ASSERT_EQ(LockProfiler::stats(LockSite::PromiseSet).acquisitions, 0u);
+        ASSERT_EQ(LockProfiler::stats(LockSite::Other).acquisitions, 2u);
+    }
+}
@@ -8,7 +8,7 @@
 TEST(m1, test1) {
     ThreadPool pool(4);
     Promise<int> p;
-    p.setPool(&pool);
+    p.setExecutor(&pool);
     pool.execute([&p](){
         p.set(0);
     });
@@ -43,7 +43,7 @@ TEST(m1, test4) {
     //ThreadPool::init();
     ThreadPool pool(cnt_threads);
     Promise<std::vector<int>> p;
-    p.setPool(&pool);
+    p.setExecutor(&pool);
     pool.execute([&p](){
         std::vector<int> v = {11, 9, 2001};
         p.set(v);
@@ -175,4 +175,37 @@ TEST(promise, SetIntAmper) {
     ASSERT_EQ(y, test);
 }
 
+TEST(promise, getRefBorrowsWithoutConsuming) {
+    Promise<std::vector<int>> promise;
+    Future<std::vector<int>> f = promise.GetFuture();
+    promise.Set(std::vector<int>(1000, 7));
+    const std::vector<int> &first = f.getRef();
+    const std::vector<int> &second = f.getRef();
+    ASSERT_EQ(&first, &second);
+    ASSERT_EQ(first.size(), 1000u);
+    ASSERT_EQ(f.Get().size(), 1000u);
+    ASSERT_THROW(f.getRef(), std::runtime_error);
+}
+
+TEST(promise, getRefRethrows) {
+    Promise<int> promise;
+    Future<int> f = promise.GetFuture();
+    promise.SetException(std::make_exception_ptr(std::out_of_range("missing")));
+    ASSERT_THROW(f.getRef(), std::out_of_range);
+}
+
+TEST(promise, consumeVisitsInPlace) {
+    Promise<std::unique_ptr<int>> promise;
+    Future<std::unique_ptr<int>> f = promise.GetFuture();
+    std::thread thread([&promise]() {
+        promise.Set(std::unique_ptr<int>(new int(5)));
+    });
+    int value = f.consume([](std::unique_ptr<int> &pointer) {
+        return *pointer * 2;
+    });
+    thread.join();
+    ASSERT_EQ(value, 10);
+    ASSERT_THROW(f.Get(), std::runtime_error);
+}
+
 #endif
\ No newline at end of file
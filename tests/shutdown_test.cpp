@@ -0,0 +1,135 @@
+#include "../Map.h"
+#include <gtest/gtest.h>
+
+// Keeps the pool's only worker busy until shutdown has taken the queued tasks out; returns
+// once the worker is on it.
+static void blockUntilQueueTaken(ThreadPool &pool) {
+    std::shared_ptr<std::atomic<bool>> started = std::make_shared<std::atomic<bool>>(false);
+    pool.execute([&pool, started]() {
+        *started = true;
+        while (!pool.isShutdown() || pool.stats().queueDepth > 0) {
+            std::this_thread::yield();
+        }
+    });
+    while (!*started) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(shutdown, drainRunsQueuedTasks) {
+    ThreadPool pool(2);
+    std::atomic<int> done(0);
+    for (int i = 0; i < 100; i++) {
+        pool.execute([&done]() {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            done++;
+        });
+    }
+    ASSERT_TRUE(pool.shutdown().empty());
+    ASSERT_EQ(done.load(), 100);
+    ASSERT_TRUE(pool.isShutdown());
+}
+
+TEST(shutdown, rejectsNewSubmissions) {
+    ThreadPool pool(2);
+    pool.shutdown();
+    ASSERT_THROW(pool.execute([]() {
+    }), RejectedExecutionError);
+    ASSERT_THROW(pool.execute(Priority::High, []() {
+    }), RejectedExecutionError);
+    ASSERT_THROW(pool.executeOn(0, []() {
+    }), RejectedExecutionError);
+    Future<int> future = submit(pool, []() {
+        return 1;
+    });
+    ASSERT_THROW(future.get(), RejectedExecutionError);
+}
+
+TEST(shutdown, shutdownNowReturnsTasksAndBreaksTheirFutures) {
+    ThreadPool pool(1);
+    blockUntilQueueTaken(pool);
+    std::atomic<int> ran(0);
+    std::vector<Future<int>> futures;
+    for (int i = 0; i < 5; i++) {
+        futures.push_back(submit(pool, [&ran, i]() {
+            ran++;
+            return i;
+        }));
+    }
+    std::vector<std::function<void()>> unrun = pool.shutdownNow();
+    ASSERT_EQ(unrun.size(), 5u);
+    ASSERT_EQ(ran.load(), 0);
+    unrun.clear();
+    for (auto &future: futures) {
+        ASSERT_THROW(future.get(), std::runtime_error);
+    }
+}
+
+TEST(shutdown, drainWithTimeoutDropsWhatIsLeft) {
+    ThreadPool pool(1);
+    std::atomic<int> ran(0);
+    for (int i = 0; i < 50; i++) {
+        pool.execute([&ran]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ran++;
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::function<void()>> unrun = pool.shutdown(ShutdownMode::DrainWithTimeout,
+                                                             std::chrono::milliseconds(30));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(400));
+    ASSERT_FALSE(unrun.empty());
+    ASSERT_EQ(ran.load() + int(unrun.size()), 50);
+}
+
+TEST(shutdown, wakesBlockedProducers) {
+    ThreadPoolOptions options;
+    options.queueCapacity = 2;
+    options.overflowPolicy = OverflowPolicy::Block;
+    ThreadPool pool(1, options);
+    std::atomic<bool> started(false);
+    std::atomic<bool> rejected(false);
+    pool.execute([&started, &rejected]() {
+        started = true;
+        while (!rejected) {
+            std::this_thread::yield();
+        }
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    std::thread producer([&pool, &rejected]() {
+        try {
+            while (true) {
+                pool.execute([]() {
+                });
+            }
+        } catch (RejectedExecutionError &) {
+            rejected = true;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    pool.shutdownNow();
+    producer.join();
+    ASSERT_TRUE(rejected.load());
+}
+
+TEST(shutdown, stopsTimers) {
+    ThreadPool pool(2);
+    std::atomic<int> fired(0);
+    pool.executeEvery(std::chrono::milliseconds(1), [&fired]() {
+        fired++;
+    });
+    TimerHandle later = pool.executeAfter(std::chrono::milliseconds(20), [&fired]() {
+        fired += 1000;
+    });
+    pool.execute([]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    pool.shutdown(ShutdownMode::DrainWithTimeout, std::chrono::milliseconds(100));
+    int afterShutdown = fired.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(fired.load(), afterShutdown);
+    ASSERT_LT(afterShutdown, 1000);
+    ASSERT_FALSE(later.isActive());
+}
@@ -0,0 +1,98 @@
+#include "../TaskGraph.h"
+#include "../ThreadPool.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+TEST(taskGraph, runsDiamondInDependencyOrder) {
+    ThreadPool pool(4);
+    TaskGraph graph(pool);
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto record = [&mutex, &order](std::string name) {
+        return [&mutex, &order, name]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            order.push_back(name);
+        };
+    };
+    TaskGraph::Node source = graph.add(record("source"), "source");
+    TaskGraph::Node left = graph.add(record("left"), "left");
+    TaskGraph::Node right = graph.add(record("right"), "right");
+    TaskGraph::Node sink = graph.add(record("sink"), "sink");
+    graph.precede(source, left);
+    graph.precede(source, right);
+    graph.precede(left, sink);
+    graph.precede(right, sink);
+    graph.run().get();
+    ASSERT_EQ(order.size(), 4u);
+    ASSERT_EQ(order.front(), "source");
+    ASSERT_EQ(order.back(), "sink");
+}
+
+TEST(taskGraph, canRunAgain) {
+    ThreadPool pool(2);
+    TaskGraph graph(pool);
+    std::atomic<int> sum(0);
+    TaskGraph::Node previous = graph.add([&sum]() {
+        sum++;
+    });
+    for (int i = 0; i < 20; i++) {
+        TaskGraph::Node node = graph.add([&sum]() {
+            sum++;
+        });
+        graph.precede(previous, node);
+        previous = node;
+    }
+    for (int run = 1; run <= 5; run++) {
+        graph.run().get();
+        ASSERT_EQ(sum.load(), 21 * run);
+    }
+}
+
+TEST(taskGraph, failureSkipsRemainingNodes) {
+    ThreadPool pool(2);
+    TaskGraph graph(pool);
+    std::atomic<bool> ranAfter(false);
+    TaskGraph::Node failing = graph.add([]() {
+        throw std::runtime_error("failed");
+    });
+    TaskGraph::Node after = graph.add([&ranAfter]() {
+        ranAfter = true;
+    });
+    graph.precede(failing, after);
+    ASSERT_THROW(graph.run().get(), std::runtime_error);
+    ASSERT_FALSE(ranAfter.load());
+    ASSERT_TRUE(graph.timings()[after].skipped);
+    ASSERT_FALSE(graph.timings()[failing].skipped);
+}
+
+TEST(taskGraph, rejectsCycles) {
+    ThreadPool pool(2);
+    TaskGraph graph(pool);
+    TaskGraph::Node first = graph.add([]() {
+    });
+    TaskGraph::Node second = graph.add([]() {
+    });
+    graph.precede(first, second);
+    graph.precede(second, first);
+    ASSERT_THROW(graph.run(), std::logic_error);
+}
+
+TEST(taskGraph, exportsTimings) {
+    ThreadPool pool(2);
+    TaskGraph graph(pool);
+    TaskGraph::Node slow = graph.add([]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }, "slow");
+    TaskGraph::Node next = graph.add([]() {
+    }, "next \"step\"");
+    graph.precede(slow, next);
+    graph.run().get();
+    std::vector<TaskGraphNodeTiming> timings = graph.timings();
+    ASSERT_EQ(timings[slow].name, "slow");
+    ASSERT_GE(timings[slow].finishNs - timings[slow].startNs, 4e6);
+    ASSERT_GE(timings[next].startNs, timings[slow].finishNs);
+    std::ostringstream trace;
+    graph.dumpChromeTrace(trace);
+    ASSERT_NE(trace.str().find("\"name\":\"slow\""), std::string::npos);
+    ASSERT_NE(trace.str().find("\"name\":\"next \\\"step\\\"\""), std::string::npos);
+}
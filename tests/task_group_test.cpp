@@ -0,0 +1,89 @@
+#include "../TaskGroup.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <gtest/gtest.h>
+
+TEST(taskGroup, runsAllChildren) {
+    ThreadPool pool(4);
+    TaskGroup group(pool);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 1000; i++) {
+        group.run([&count]() {
+            count++;
+        });
+    }
+    group.wait();
+    ASSERT_EQ(count, 1000);
+}
+
+TEST(taskGroup, childrenMaySpawnChildren) {
+    ThreadPool pool(2);
+    TaskGroup group(pool);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 10; i++) {
+        group.run([&group, &count]() {
+            for (int j = 0; j < 10; j++) {
+                group.run([&count]() {
+                    count++;
+                });
+            }
+        });
+    }
+    group.wait();
+    ASSERT_EQ(count, 100);
+}
+
+TEST(taskGroup, waitRunsChildrenOnCallingThread) {
+    ThreadPoolOptions options;
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(1, options);
+    Promise<void> release;
+    Future<void> released = release.getFuture();
+    pool.execute([&released]() {
+        released.wait();
+    });
+    TaskGroup group(pool);
+    std::thread::id runner;
+    group.run([&runner]() {
+        runner = std::this_thread::get_id();
+    });
+    group.wait();
+    ASSERT_EQ(runner, std::this_thread::get_id());
+    release.set();
+}
+
+TEST(taskGroup, firstExceptionIsRethrown) {
+    ThreadPool pool(2);
+    TaskGroup group(pool);
+    group.run([]() {
+        throw std::runtime_error("child failed");
+    });
+    group.run([]() {});
+    ASSERT_THROW(group.wait(), std::runtime_error);
+    group.run([]() {});
+    group.wait();
+}
+
+TEST(taskGroup, cancelOnErrorSkipsPendingSiblings) {
+    ThreadPoolOptions options;
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(1, options);
+    Promise<void> release;
+    Future<void> released = release.getFuture();
+    pool.execute([&released]() {
+        released.wait();
+    });
+    TaskGroup group(pool, true);
+    std::atomic<int> ran(0);
+    for (int i = 0; i < 10; i++) {
+        group.run([&ran]() {
+            ran++;
+        });
+    }
+    group.run([]() {
+        throw std::runtime_error("child failed");
+    });
+    release.set();
+    ASSERT_THROW(group.wait(), std::runtime_error);
+    ASSERT_LT(ran, 10);
+}
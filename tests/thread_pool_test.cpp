@@ -0,0 +1,323 @@
+#include "../ThreadPool.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <gtest/gtest.h>
+
+TEST(threadPool, statsCountExecutedTasks) {
+    ThreadPool pool(2);
+    const size_t n = 100;
+    std::atomic<size_t> done(0);
+    for (size_t i = 0; i < n; i++) {
+        pool.execute([&done]() {
+            done++;
+        });
+    }
+    while (done != n) {
+        std::this_thread::yield();
+    }
+    ThreadPoolStats stats = pool.stats();
+    ASSERT_EQ(stats.workers.size(), 2u);
+    ASSERT_GE(stats.queueHighWaterMark, 1u);
+    if (statsEnabled) {
+        ASSERT_EQ(stats.total.tasksInjected, stats.total.tasksExecuted);
+    }
+}
+
+TEST(threadPool, statsQueueDepth) {
+    ThreadPoolOptions options;
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(1, options);
+    Promise<void> gate;
+    Future<void> gateFuture = gate.getFuture();
+    Promise<void> started;
+    Future<void> startedFuture = started.getFuture();
+    pool.execute([&gateFuture, &started]() {
+        started.set();
+        gateFuture.wait();
+    });
+    startedFuture.wait();
+    for (int i = 0; i < 3; i++) {
+        pool.execute([]() {});
+    }
+    ThreadPoolStats stats = pool.stats();
+    ASSERT_EQ(stats.queueDepth, 3u);
+    ASSERT_EQ(stats.queueHighWaterMark, 3u);
+    gate.set();
+}
+
+TEST(threadPool, executeOnRunsOnTargetWorker) {
+    ThreadPool pool(4);
+    ASSERT_EQ(pool.currentWorkerIndex(), -1);
+    std::atomic<size_t> done(0);
+    std::atomic<size_t> misplaced(0);
+    for (size_t i = 0; i < 400; i++) {
+        size_t target = i % pool.size();
+        pool.executeOn(target, [&pool, &done, &misplaced, target]() {
+            if (pool.currentWorkerIndex() != int(target)) {
+                misplaced++;
+            }
+            done++;
+        });
+    }
+    while (done.load() < 400) {
+        std::this_thread::yield();
+    }
+    // Tasks may be stolen after the affinity timeout, but most stay on their worker.
+    ASSERT_LT(misplaced.load(), 200u);
+    ASSERT_THROW(pool.executeOn(4, []() {}), std::out_of_range);
+}
+
+TEST(threadPool, executeLocalStaysOnCallingWorker) {
+    ThreadPoolOptions options;
+    options.affinityTimeout = std::chrono::seconds(10);
+    ThreadPool pool(3, options);
+    Promise<bool> promise;
+    Future<bool> future = promise.getFuture();
+    pool.execute([&pool, &promise]() {
+        int index = pool.currentWorkerIndex();
+        pool.executeLocal([&pool, &promise, index]() {
+            promise.set(pool.currentWorkerIndex() == index);
+        });
+    });
+    ASSERT_TRUE(future.get());
+}
+
+TEST(threadPool, executeLocalFromCompensationWorker) {
+    ThreadPoolOptions options;
+    options.maxCompensationWorkers = 1;
+    ThreadPool pool(1, options);
+    Promise<void> release;
+    std::shared_ptr<Future<void>> released = std::make_shared<Future<void>>(release.getFuture());
+    pool.execute([released]() {
+        released->get();
+    });
+    Promise<int> ranOn;
+    Future<int> ranOnFuture = ranOn.getFuture();
+    pool.execute([&pool, &ranOn]() {
+        pool.executeLocal([&pool, &ranOn]() {
+            ranOn.set(pool.currentWorkerIndex());
+        });
+    });
+    ASSERT_GE(ranOnFuture.get(), 1);
+    release.set();
+}
+
+TEST(threadPool, staleAffinityTaskIsStolen) {
+    ThreadPoolOptions options;
+    options.affinityTimeout = std::chrono::milliseconds(5);
+    options.maxCompensationWorkers = 0;
+    ThreadPool pool(2, options);
+    Promise<void> release;
+    std::shared_ptr<Future<void>> released = std::make_shared<Future<void>>(release.getFuture());
+    Promise<int> blockedIndex;
+    Future<int> blockedIndexFuture = blockedIndex.getFuture();
+    pool.execute([&pool, released, &blockedIndex]() {
+        blockedIndex.set(pool.currentWorkerIndex());
+        released->get();
+    });
+    int busy = blockedIndexFuture.get();
+    Promise<int> ranOn;
+    Future<int> ranOnFuture = ranOn.getFuture();
+    pool.executeOn(size_t(busy), [&pool, &ranOn]() {
+        ranOn.set(pool.currentWorkerIndex());
+    });
+    ASSERT_EQ(ranOnFuture.get(), 1 - busy);
+    release.set();
+}
+
+TEST(threadPool, elasticPoolGrowsUnderBacklogAndShrinksWhenIdle) {
+    ThreadPoolOptions options;
+    options.minWorkers = 1;
+    options.maxWorkers = 4;
+    options.growQueueDepth = 2;
+    options.growAfter = std::chrono::milliseconds(2);
+    options.keepAlive = std::chrono::milliseconds(50);
+    ThreadPool pool(1, options);
+    ASSERT_EQ(pool.activeWorkers(), 1u);
+    ASSERT_EQ(pool.size(), 4u);
+
+    std::atomic<bool> released(false);
+    std::atomic<size_t> started(0);
+    for (int i = 0; i < 8; i++) {
+        pool.execute([&released, &started]() {
+            started++;
+            while (!released) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    while (started.load() < 4) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(pool.stats().activeWorkers, 4u);
+    released = true;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.activeWorkers() > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(pool.activeWorkers(), 1u);
+
+    Promise<int> promise;
+    Future<int> future = promise.getFuture();
+    pool.execute([&promise]() {
+        promise.set(7);
+    });
+    ASSERT_EQ(future.get(), 7);
+}
+
+TEST(threadPool, nestedWaitOnSingleWorkerIsCompensated) {
+    ThreadPool pool(1);
+    Promise<int> outer;
+    Future<int> outerFuture = outer.getFuture();
+    pool.execute([&pool, &outer]() {
+        std::shared_ptr<Promise<int>> inner = std::make_shared<Promise<int>>();
+        Future<int> innerFuture = inner->getFuture();
+        // Queued behind the running task: without compensation this waits forever.
+        pool.execute([inner]() {
+            inner->set(41);
+        });
+        outer.set(innerFuture.get() + 1);
+    });
+    ASSERT_EQ(outerFuture.get(), 42);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.activeWorkers() > 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ThreadPoolStats stats = pool.stats();
+    ASSERT_EQ(stats.activeWorkers, 1u);
+    ASSERT_EQ(stats.blockedWorkers, 0u);
+    if (statsEnabled) {
+        ASSERT_EQ(stats.compensation.tasksExecuted, 1u);
+    }
+}
+
+TEST(threadPool, compensationSlotsScaleWithPoolSize) {
+    ASSERT_EQ(ThreadPool(1).workerSlots(), 2u);
+    ASSERT_EQ(ThreadPool(3).workerSlots(), 6u);
+    ASSERT_EQ(ThreadPool(12).workerSlots(), 20u);
+    ThreadPoolOptions options;
+    options.maxCompensationWorkers = 0;
+    ASSERT_EQ(ThreadPool(3, options).workerSlots(), 3u);
+}
+
+TEST(threadPool, blockingKeepsParallelism) {
+    ThreadPool pool(2);
+    std::atomic<bool> released(false);
+    std::atomic<int> blocked(0);
+    for (int i = 0; i < 2; i++) {
+        pool.execute([&released, &blocked]() {
+            ThreadPool::blocking([&released, &blocked]() {
+                blocked++;
+                while (!released) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+        });
+    }
+    while (blocked.load() < 2) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(pool.stats().blockedWorkers, 2u);
+    ASSERT_EQ(pool.activeWorkers(), 4u);
+    Promise<int> promise;
+    Future<int> future = promise.getFuture();
+    pool.execute([&promise]() {
+        promise.set(ThreadPool::blocking([]() {
+            return 5;
+        }));
+    });
+    ASSERT_EQ(future.get(), 5);
+    released = true;
+    ASSERT_EQ(ThreadPool::blocking([]() {
+        return 7;
+    }), 7);
+}
+
+TEST(threadPool, priorityLanesAndDeadlines) {
+    ThreadPoolOptions options;
+    options.maxCompensationWorkers = 0;
+    options.agingThreshold = std::chrono::seconds(10);
+    ThreadPool pool(1, options);
+    std::atomic<bool> released(false);
+    std::atomic<bool> started(false);
+    pool.execute([&released, &started]() {
+        started = true;
+        while (!released) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    std::vector<std::string> order;
+    auto now = std::chrono::steady_clock::now();
+    pool.execute(Priority::Low, [&order]() {
+        order.push_back("low");
+    });
+    pool.execute([&order]() {
+        order.push_back("normal");
+    });
+    pool.executeBy(now + std::chrono::seconds(2), [&order]() {
+        order.push_back("deadline 2s");
+    });
+    pool.execute(Priority::High, [&order]() {
+        order.push_back("high");
+    });
+    pool.executeBy(now + std::chrono::seconds(1), [&order]() {
+        order.push_back("deadline 1s");
+    });
+    ThreadPoolStats stats = pool.stats();
+    ASSERT_EQ(stats.lanes[size_t(Lane::High)].queueDepth, 1u);
+    ASSERT_EQ(stats.lanes[size_t(Lane::Normal)].queueDepth, 1u);
+    ASSERT_EQ(stats.lanes[size_t(Lane::Low)].queueDepth, 1u);
+    ASSERT_EQ(stats.lanes[size_t(Lane::Deadline)].queueDepth, 2u);
+
+    // Normal tasks run after every other lane and in order, so this one runs last.
+    Promise<void> done;
+    Future<void> doneFuture = done.getFuture();
+    pool.execute([&done]() {
+        done.set();
+    });
+    released = true;
+    doneFuture.get();
+    ASSERT_EQ(order, std::vector<std::string>({"high", "deadline 1s", "deadline 2s", "low", "normal"}));
+    if (statsEnabled) {
+        ASSERT_EQ(pool.stats().lanes[size_t(Lane::Deadline)].tasksExecuted, 2u);
+    }
+}
+
+TEST(threadPool, agingServesStarvedNormalLane) {
+    ThreadPoolOptions options;
+    options.agingThreshold = std::chrono::milliseconds(5);
+    std::atomic<bool> stop(false);
+    std::function<void()> flood;
+    ThreadPool pool(1, options);
+    // Keeps the High lane non-empty until the Normal task has run.
+    flood = [&pool, &stop, &flood]() {
+        if (!stop) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            pool.execute(Priority::High, flood);
+        }
+    };
+    pool.execute(Priority::High, flood);
+    pool.execute(Priority::High, flood);
+    Promise<void> normal;
+    Future<void> normalFuture = normal.getFuture();
+    pool.execute([&normal]() {
+        normal.set();
+    });
+    normalFuture.get();
+    stop = true;
+}
+
+TEST(threadPool, alignedArraysStartOnCacheLines) {
+    AlignedArray<WorkerCounters> counters = makeAlignedArray<WorkerCounters>(3);
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(&counters[i]) % 64, 0u);
+        ASSERT_EQ(counters[i].tasksExecuted.load(), 0u);
+    }
+    AlignedPtr<BoundedQueue<int>> queue = makeAligned<BoundedQueue<int>>(8);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(queue.get()) % 64, 0u);
+}
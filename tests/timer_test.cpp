@@ -0,0 +1,105 @@
+#include "../ThreadPool.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono;
+
+TEST(timerWheel, firesAfterCascading) {
+    TimerWheel wheel;
+    auto start = TimerWheel::Clock::now();
+    int fired = 0;
+    wheel.schedule(start + seconds(70), TimerWheel::Clock::duration::zero(), [&fired]() {
+        fired++;
+    });
+    wheel.schedule(start + milliseconds(5), TimerWheel::Clock::duration::zero(), [&fired]() {
+        fired += 10;
+    });
+    for (auto &callback: wheel.advance(start + milliseconds(4))) {
+        callback();
+    }
+    ASSERT_EQ(fired, 0);
+    for (auto &callback: wheel.advance(start + seconds(69))) {
+        callback();
+    }
+    ASSERT_EQ(fired, 10);
+    for (auto &callback: wheel.advance(start + seconds(71))) {
+        callback();
+    }
+    ASSERT_EQ(fired, 11);
+    ASSERT_EQ(wheel.size(), 0u);
+}
+
+TEST(timerWheel, cancelUnlinks) {
+    TimerWheel wheel;
+    auto start = TimerWheel::Clock::now();
+    std::vector<TimerHandle> handles;
+    int fired = 0;
+    for (int i = 0; i < 1000; i++) {
+        handles.push_back(wheel.schedule(start + milliseconds(i), TimerWheel::Clock::duration::zero(), [&fired]() {
+            fired++;
+        }));
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        ASSERT_TRUE(handles[i].cancel());
+        ASSERT_FALSE(handles[i].cancel());
+    }
+    ASSERT_EQ(wheel.size(), 500u);
+    for (auto &callback: wheel.advance(start + seconds(2))) {
+        callback();
+    }
+    ASSERT_EQ(fired, 500);
+    ASSERT_FALSE(handles[1].isActive());
+}
+
+TEST(timer, executeAfterWaitsForDelay) {
+    ThreadPool pool(2);
+    Promise<steady_clock::time_point> promise;
+    Future<steady_clock::time_point> future = promise.getFuture();
+    auto start = steady_clock::now();
+    pool.executeAfter(milliseconds(50), [&promise]() {
+        promise.set(steady_clock::now());
+    });
+    ASSERT_GE(future.get() - start, milliseconds(50));
+}
+
+TEST(timer, cancelledTimerDoesNotRun) {
+    ThreadPool pool(1);
+    std::atomic<bool> ran(false);
+    TimerHandle handle = pool.executeAfter(milliseconds(50), [&ran]() {
+        ran = true;
+    });
+    ASSERT_TRUE(handle.cancel());
+    std::this_thread::sleep_for(milliseconds(100));
+    ASSERT_FALSE(ran);
+}
+
+TEST(timer, executeEveryRepeatsUntilCancelled) {
+    ThreadPool pool(2);
+    std::atomic<int> runs(0);
+    TimerHandle handle = pool.executeEvery(milliseconds(10), [&runs]() {
+        runs++;
+    });
+    while (runs < 3) {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    ASSERT_TRUE(handle.cancel());
+    std::this_thread::sleep_for(milliseconds(20));
+    int after = runs;
+    std::this_thread::sleep_for(milliseconds(50));
+    ASSERT_EQ(runs, after);
+}
+
+TEST(timer, earlierTimerWakesParkedWorker) {
+    ThreadPool pool(1);
+    pool.executeAfter(seconds(60), []() {});
+    std::this_thread::sleep_for(milliseconds(20));
+    Promise<void> promise;
+    Future<void> future = promise.getFuture();
+    auto start = steady_clock::now();
+    pool.executeAfter(milliseconds(10), [&promise]() {
+        promise.set();
+    });
+    future.get();
+    ASSERT_LT(steady_clock::now() - start, seconds(5));
+}
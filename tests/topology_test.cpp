@@ -0,0 +1,109 @@
+#include "../ThreadPool.h"
+#include "../Promise.h"
+#include "../Future.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void writeFile(const std::string &path, const std::string &content) {
+    std::ofstream out(path);
+    out << content << "\n";
+}
+
+// Two nodes with two hyperthreaded cores each: node0 = cpus 0,1,4,5, node1 = cpus 2,3,6,7,
+// where cpu n and n + 4 are siblings.
+static std::string makeFakeSysfs() {
+    char pattern[] = "/tmp/topology_testXXXXXX";
+    std::string root = mkdtemp(pattern);
+    mkdir((root + "/node").c_str(), 0755);
+    mkdir((root + "/node/node0").c_str(), 0755);
+    mkdir((root + "/node/node1").c_str(), 0755);
+    mkdir((root + "/node/node2").c_str(), 0755);
+    writeFile(root + "/node/node0/cpulist", "0-1,4-5");
+    writeFile(root + "/node/node1/cpulist", "2-3,6-7");
+    writeFile(root + "/node/node2/cpulist", "");
+    mkdir((root + "/cpu").c_str(), 0755);
+    for (int cpu = 0; cpu < 8; cpu++) {
+        std::string dir = root + "/cpu/cpu" + std::to_string(cpu);
+        mkdir(dir.c_str(), 0755);
+        mkdir((dir + "/topology").c_str(), 0755);
+        writeFile(dir + "/topology/thread_siblings_list",
+                  std::to_string(cpu % 4) + "," + std::to_string(cpu % 4 + 4));
+    }
+    return root;
+}
+
+TEST(topology, parseCpuList) {
+    ASSERT_EQ(Topology::parseCpuList("0-3,8,10-11"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_EQ(Topology::parseCpuList(""), std::vector<int>());
+}
+
+TEST(topology, readsNodesAndCores) {
+    std::string root = makeFakeSysfs();
+    Topology topology = Topology::read(root + "/node", root + "/cpu");
+    ASSERT_EQ(topology.nodes().size(), 2u);
+    ASSERT_EQ(topology.nodes()[1].id, 1);
+    ASSERT_EQ(topology.nodes()[1].cpus, std::vector<int>({2, 3, 6, 7}));
+    ASSERT_EQ(topology.cores(), std::vector<int>({0, 1, 2, 3}));
+    ASSERT_EQ(topology.nodeIndexOfCpu(6), 1u);
+}
+
+TEST(topology, missingSysfsFallsBackToOneNode) {
+    Topology topology = Topology::read("/nonexistent/node", "/nonexistent/cpu");
+    ASSERT_EQ(topology.nodes().size(), 1u);
+    ASSERT_FALSE(topology.nodes()[0].cpus.empty());
+}
+
+TEST(topology, perNodePlacementAndNodeQueues) {
+    std::string root = makeFakeSysfs();
+    Topology topology = Topology::read(root + "/node", root + "/cpu");
+    ThreadPoolOptions options;
+    options.placement = WorkerPlacement::PerNode;
+    options.topology = &topology;
+    options.affinityTimeout = std::chrono::seconds(10);
+    ThreadPool pool(4, options);
+    ASSERT_EQ(pool.workerNode(0), 0);
+    ASSERT_EQ(pool.workerNode(1), 1);
+    ASSERT_EQ(pool.workerNode(3), 1);
+
+    // With the node 1 workers busy, node 0 steals the task. The workers spin rather than
+    // wait on a future, which would bring in compensation workers.
+    std::atomic<bool> released(false);
+    std::atomic<int> blocked(0);
+    for (size_t worker: {1, 3}) {
+        pool.executeOn(worker, [&released, &blocked]() {
+            blocked++;
+            while (!released) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    while (blocked.load() < 2) {
+        std::this_thread::yield();
+    }
+    Promise<int> ranOn;
+    Future<int> ranOnFuture = ranOn.getFuture();
+    pool.executeOnNode(1, [&pool, &ranOn]() {
+        ranOn.set(pool.workerNode(size_t(pool.currentWorkerIndex())));
+    });
+    ASSERT_EQ(ranOnFuture.get(), 0);
+    released = true;
+    ASSERT_THROW(pool.executeOnNode(5, []() {}), std::out_of_range);
+}
+
+TEST(topology, perCorePlacementPinsWorkers) {
+    ThreadPoolOptions options;
+    options.placement = WorkerPlacement::PerCore;
+    options.affinityTimeout = std::chrono::seconds(10);
+    ThreadPool pool(2, options);
+    const std::vector<int> &cores = Topology::system().cores();
+    for (size_t i = 0; i < pool.size(); i++) {
+        Promise<int> promise;
+        Future<int> future = promise.getFuture();
+        pool.executeOn(i, [&promise]() {
+            promise.set(sched_getcpu());
+        });
+        ASSERT_EQ(future.get(), cores[i % cores.size()]);
+    }
+}
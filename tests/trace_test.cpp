@@ -0,0 +1,58 @@
+#include "../Map.h"
+#include "../Trace.h"
+#include <sstream>
+#include <gtest/gtest.h>
+
+TEST(trace, mapChainProducesConnectedFlows) {
+    ThreadPool pool(2);
+    Promise<int> promise;
+    promise.setExecutor(&pool);
+    Future<int> future = Map(promise.getFuture(), [](int value) {
+        return value + 1;
+    });
+    promise.set(1);
+    ASSERT_EQ(future.get(), 2);
+
+    std::ostringstream out;
+    Trace::dumpChromeTrace(out);
+    std::string json = out.str();
+    ASSERT_EQ(json.front(), '{');
+    if (traceEnabled) {
+        ASSERT_NE(json.find("\"continuation dispatch\""), std::string::npos);
+        ASSERT_NE(json.find("\"promise set\""), std::string::npos);
+        ASSERT_NE(json.find("\"ph\":\"s\""), std::string::npos);
+        ASSERT_NE(json.find("\"ph\":\"f\""), std::string::npos);
+        ASSERT_NE(json.find("ThreadPool worker"), std::string::npos);
+    }
+}
+
+TEST(trace, bufferKeepsFixedCapacity) {
+    TraceBuffer buffer(1);
+    for (size_t i = 0; i < TraceBuffer::capacity * 3; i++) {
+        buffer.record(TraceEventType::TaskEnqueue, i, 0);
+    }
+    ASSERT_EQ(buffer.head.load(), TraceBuffer::capacity * 3);
+    ASSERT_EQ(buffer.slots[0].flowId.load(), TraceBuffer::capacity * 2);
+}
+
+TEST(trace, exitedThreadsHandTheirBuffersOn) {
+    const uint64_t marker = 987650000;
+    for (uint64_t i = 0; i < 20; i++) {
+        std::thread([marker, i]() {
+            Trace::record(TraceEventType::TaskEnqueue, marker + i);
+        }).join();
+    }
+    std::ostringstream out;
+    Trace::dumpChromeTrace(out);
+    std::string json = out.str();
+    if (traceEnabled) {
+        ASSERT_EQ(json.find("\"flow_id\":" + std::to_string(marker) + ","), std::string::npos);
+        ASSERT_NE(json.find("\"flow_id\":" + std::to_string(marker + 19) + ","), std::string::npos);
+    }
+}
+
+TEST(trace, jsonStringsAreEscaped) {
+    std::ostringstream out;
+    Trace::writeJsonString(out, "say \"hi\"\\\n\x01");
+    ASSERT_EQ(out.str(), "\"say \\\"hi\\\"\\\\\\n\\u0001\"");
+}
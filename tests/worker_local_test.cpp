@@ -0,0 +1,70 @@
+#include "../WorkerLocal.h"
+#include "../TaskGroup.h"
+#include <gtest/gtest.h>
+
+TEST(workerLocal, sumsAcrossWorkers) {
+    ThreadPool pool(4);
+    WorkerLocal<long> sums(pool);
+    {
+        TaskGroup group(pool);
+        for (int i = 1; i <= 1000; i++) {
+            group.run([&sums, i]() {
+                sums.local() += i;
+            });
+        }
+        group.wait();
+    }
+    ASSERT_EQ(sums.combine([](long a, long b) {
+        return a + b;
+    }), 500500);
+}
+
+TEST(workerLocal, workersGetTheirOwnSlot) {
+    ThreadPool pool(2);
+    WorkerLocal<std::vector<int>> seen(pool);
+    seen.local().push_back(-1);
+    std::atomic<int> done(0);
+    for (int i = 0; i < 100; i++) {
+        pool.execute([&seen, &pool, &done]() {
+            seen.local().push_back(pool.currentWorkerIndex());
+            done++;
+        });
+    }
+    while (done.load() < 100) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(seen.size(), pool.workerSlots() + 1);
+    size_t total = 0;
+    size_t slot = 0;
+    seen.forEach([&total, &slot, &seen](std::vector<int> &values) {
+        for (int index: values) {
+            ASSERT_EQ(index, slot + 1 == seen.size() ? -1 : int(slot));
+        }
+        total += values.size();
+        slot++;
+    });
+    ASSERT_EQ(total, 101u);
+}
+
+TEST(workerLocal, startsFromInitialValue) {
+    ThreadPool pool(2);
+    WorkerLocal<int> values(pool, 3);
+    values.forEach([](int &value) {
+        value *= 2;
+    });
+    ASSERT_EQ(values.combine([](int a, int b) {
+        return std::max(a, b);
+    }), 6);
+}
+
+TEST(workerLocal, slotsStartOnCacheLines) {
+    ThreadPool pool(2);
+    WorkerLocal<int> values(pool);
+    std::vector<uintptr_t> addresses;
+    values.forEach([&addresses](int &value) {
+        addresses.push_back(reinterpret_cast<uintptr_t>(&value));
+    });
+    for (uintptr_t address: addresses) {
+        ASSERT_EQ(address % 64, 0u);
+    }
+}